@@ -0,0 +1,287 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ride {
+
+namespace detail {
+
+// something waiting on several channels at once, notified whenever one of them
+// changed in a way it waits for
+class ChannelWaiter
+{
+  public:
+    ChannelWaiter() = default;
+    ChannelWaiter(const ChannelWaiter&) = delete;
+    ChannelWaiter& operator = (const ChannelWaiter&) = delete;
+    virtual ~ChannelWaiter() = default;
+
+    // called with the channel's lock held, so it must not use the channel
+    virtual void notify() = 0;
+};
+
+} // end namespace detail
+
+// a queue to pass values between threads, closing it lets receivers drain what is
+// left and then fails every operation
+//
+// a channel with a capacity of zero is unbuffered, a send waits until a receiver
+// took its value
+template <class T_>
+class Channel
+{
+    typedef std::mutex Mutex;
+    typedef std::unique_lock<Mutex> Lock;
+    typedef std::lock_guard<Mutex> LockGuard;
+    typedef std::vector<detail::ChannelWaiter*> Waiters;
+
+    mutable Mutex mutex;
+    std::condition_variable readable, writable;
+    std::deque<T_> buffer;
+    std::size_t capacity;
+    bool closed;
+    // receivers blocked in a receive, each takes whatever is in the buffer before it leaves,
+    // so a send that mustn't wait can hand them its value through an unbuffered channel
+    //
+    // selects don't count, they may fire another case and leave the value behind
+    std::size_t num_parked_receivers;
+    // an unbuffered send waits until as many values were received as were sent before it
+    std::size_t num_sent, num_received;
+    // selects waiting to receive and to send
+    Waiters receive_waiters, send_waiters;
+
+    static inline void notifyAll(const Waiters& waiters)
+    {
+        for (detail::ChannelWaiter* waiter : waiters)
+            waiter->notify();
+    }
+
+    static inline void removeWaiter(Waiters& waiters, detail::ChannelWaiter& waiter)
+    { waiters.erase(std::find(waiters.begin(), waiters.end(), &waiter)); }
+
+    inline bool unsafeCanSend(bool will_wait) const
+    {
+        if (this->capacity)
+            return this->buffer.size() < this->capacity;
+        return this->buffer.empty() && (will_wait || this->num_parked_receivers > 0);
+    }
+
+    // returns the value's ticket, received once num_received passes it
+    template <class Value_>
+    inline std::size_t unsafeSend(Value_&& value)
+    {
+        this->buffer.push_back(std::forward<Value_>(value));
+
+        this->readable.notify_one();
+        notifyAll(this->receive_waiters);
+
+        return this->num_sent++;
+    }
+
+    inline void unsafeReceive(T_& value)
+    {
+        value = std::move(this->buffer.front());
+        this->buffer.pop_front();
+        ++this->num_received;
+
+        // unbuffered senders wait for their own value, so all of them have to look
+        if (this->capacity)
+            this->writable.notify_one();
+        else
+            this->writable.notify_all();
+        notifyAll(this->send_waiters);
+    }
+
+    template <class Value_>
+    inline bool sendUntil(Value_&& value, const std::chrono::steady_clock::time_point* timeout_time)
+    {
+        Lock lock(this->mutex);
+
+        auto can_send = [this]() { return this->closed || this->unsafeCanSend(true); };
+        if (!timeout_time)
+            this->writable.wait(lock, can_send);
+        else if (!this->writable.wait_until(lock, *timeout_time, can_send))
+            return false;
+
+        if (this->closed)
+            return false;
+
+        std::size_t ticket = this->unsafeSend(std::forward<Value_>(value));
+
+        if (this->capacity)
+            return true;
+
+        auto taken = [this, ticket]() { return this->closed || this->num_received > ticket; };
+        if (!timeout_time)
+            this->writable.wait(lock, taken);
+        else if (!this->writable.wait_until(lock, *timeout_time, taken))
+        {
+            // nobody took it in time, an unbuffered channel only ever holds this one value
+            this->buffer.pop_back();
+            --this->num_sent;
+            return false;
+        }
+
+        return true;
+    }
+
+    inline bool receiveUntil(T_& value, const std::chrono::steady_clock::time_point* timeout_time)
+    {
+        Lock lock(this->mutex);
+
+        ++this->num_parked_receivers;
+
+        // a select waiting to send can hand its value over now
+        if (!this->capacity)
+            notifyAll(this->send_waiters);
+
+        auto can_receive = [this]() { return this->closed || !this->buffer.empty(); };
+        if (!timeout_time)
+            this->readable.wait(lock, can_receive);
+        else
+            this->readable.wait_until(lock, *timeout_time, can_receive);
+
+        --this->num_parked_receivers;
+
+        // checked after a timeout too, a value handed over while waking up is still ours
+        if (this->buffer.empty())
+            return false;
+
+        this->unsafeReceive(value);
+        return true;
+    }
+  public:
+    Channel(std::size_t capacity = 0)
+      : capacity(capacity)
+      , closed(false)
+      , num_parked_receivers(0)
+      , num_sent(0)
+      , num_received(0)
+    { }
+
+    Channel(const Channel&) = delete;
+    Channel& operator = (const Channel&) = delete;
+
+    // false once the channel is closed
+    inline bool send(const T_& value)
+    { return this->sendUntil(value, nullptr); }
+
+    inline bool send(T_&& value)
+    { return this->sendUntil(std::move(value), nullptr); }
+
+    // never waits, an unbuffered channel needs a receiver already blocked in a receive
+    inline bool trySend(const T_& value)
+    {
+        LockGuard lock(this->mutex);
+
+        if (this->closed || !this->unsafeCanSend(false))
+            return false;
+
+        this->unsafeSend(value);
+        return true;
+    }
+
+    template <class Rep_, class Period_>
+    inline bool trySendFor(T_ value, const std::chrono::duration<Rep_, Period_>& duration)
+    { return this->trySendUntil(std::move(value), std::chrono::steady_clock::now() + duration); }
+
+    inline bool trySendUntil(T_ value, std::chrono::steady_clock::time_point timeout_time)
+    { return this->sendUntil(std::move(value), &timeout_time); }
+
+    // false once the channel is closed and every value was received
+    inline bool receive(T_& value)
+    { return this->receiveUntil(value, nullptr); }
+
+    inline bool tryReceive(T_& value)
+    {
+        LockGuard lock(this->mutex);
+
+        if (this->buffer.empty())
+            return false;
+
+        this->unsafeReceive(value);
+        return true;
+    }
+
+    template <class Rep_, class Period_>
+    inline bool tryReceiveFor(T_& value, const std::chrono::duration<Rep_, Period_>& duration)
+    { return this->tryReceiveUntil(value, std::chrono::steady_clock::now() + duration); }
+
+    inline bool tryReceiveUntil(T_& value, std::chrono::steady_clock::time_point timeout_time)
+    { return this->receiveUntil(value, &timeout_time); }
+
+    // wakes everything waiting on the channel, values already sent can still be received
+    inline void close()
+    {
+        LockGuard lock(this->mutex);
+
+        this->closed = true;
+
+        this->readable.notify_all();
+        this->writable.notify_all();
+        notifyAll(this->receive_waiters);
+        notifyAll(this->send_waiters);
+    }
+
+    inline bool isClosed() const
+    {
+        LockGuard lock(this->mutex);
+        return this->closed;
+    }
+
+    // closed with nothing left to receive
+    inline bool isDrained() const
+    {
+        LockGuard lock(this->mutex);
+        return this->closed && this->buffer.empty();
+    }
+
+    inline std::size_t size() const
+    {
+        LockGuard lock(this->mutex);
+        return this->buffer.size();
+    }
+
+    inline std::size_t getCapacity() const
+    { return this->capacity; }
+  public: // used by Select
+    inline void subscribeReceive(detail::ChannelWaiter& waiter)
+    {
+        LockGuard lock(this->mutex);
+
+        this->receive_waiters.push_back(&waiter);
+    }
+
+    inline void unsubscribeReceive(detail::ChannelWaiter& waiter)
+    {
+        LockGuard lock(this->mutex);
+
+        removeWaiter(this->receive_waiters, waiter);
+    }
+
+    inline void subscribeSend(detail::ChannelWaiter& waiter)
+    {
+        LockGuard lock(this->mutex);
+        this->send_waiters.push_back(&waiter);
+    }
+
+    inline void unsubscribeSend(detail::ChannelWaiter& waiter)
+    {
+        LockGuard lock(this->mutex);
+        removeWaiter(this->send_waiters, waiter);
+    }
+};
+
+} // end namespace ride
@@ -12,83 +12,13 @@
 
 namespace ride {
 
-namespace detail {
-
-template <class T_, class Alloc_, class... Args_>
-class Emplacer<std::deque<T_, Alloc_>, Args_...>
-  : AbstractEmplacer<std::deque<T_, Alloc_>>
-  , BasicForwardEmplacer<Args_...>
-  , BasicBackwardEmplacer<Args_...>
-{
-  public:
-    using AbstractEmplacer<std::deque<T_, Alloc_>>::AbstractEmplacer;
-
-    inline void emplaceFront(Args_&&... args) override
-    {
-        this->container.emplace_front(std::forward<Args_>(args)...);
-    }
-
-    inline void emplaceBack(Args_&&... args) override
-    {
-        this->container.emplace_back(std::forward<Args_>(args)...);
-    }
-};
-
-} // end namespace detail
-
+// std::deque is covered by the default ContainerAdapter
 template <class T_, class Alloc_ = std::allocator<T_>>
-class ConcurrentDeque
-  : public detail::BidirectionalConcurrentContainer<T_, std::deque<T_, Alloc_>>
+class ConcurrentDeque final
+  : public detail::BidirectionalConcurrentContainer<T_, std::deque<T_, Alloc_>, ConcurrentDeque<T_, Alloc_>>
 {
-  private:
-    inline bool unsafeIsEmpty() const override
-    { return this->data.empty(); }
-
-    inline std::size_t unsafeSize() const override
-    { return this->data.size(); }
-
-    inline void unsafeClear() override
-    { this->data.clear(); }
-
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Winconsistent-missing-override"
-    inline void unsafeAddFront(const T_& element)
-    { this->data.push_front(element); }
-    inline void unsafeAddFront(T_&& element)
-    { this->data.push_front(std::move(element)); }
-    inline void unsafeAddBack(const T_& element)
-    { this->data.push_back(element); }
-    inline void unsafeAddBack(T_&& element)
-    { this->data.push_back(std::move(element)); }
-
-    inline void unsafeRemoveFront(T_& element)
-    {
-        element = this->data.front();
-        this->data.pop_front();
-    }
-
-    inline void unsafeRemoveFront(T_&& element)
-    {
-        element = std::move(this->data.front());
-        this->data.pop_front();
-    }
-
-    inline void unsafeRemoveBack(T_& element)
-    {
-        element = this->data.back();
-        this->data.pop_back();
-    }
-
-    inline void unsafeRemoveBack(T_&& element)
-    {
-        element = std::move(this->data.back());
-        this->data.pop_back();
-    }
-#pragma clang diagnostic pop
   public:
-    using detail::BidirectionalConcurrentContainer<T_, std::deque<T_, Alloc_>>::BidirectionalConcurrentContainer;
-    virtual ~ConcurrentDeque() = default;
+    using detail::BidirectionalConcurrentContainer<T_, std::deque<T_, Alloc_>, ConcurrentDeque<T_, Alloc_>>::BidirectionalConcurrentContainer;
 };
 
 } // end namespace ride
-
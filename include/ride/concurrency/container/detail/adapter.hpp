@@ -0,0 +1,61 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <utility>
+
+namespace ride { namespace detail {
+
+// maps the operations of the concurrent containers onto the underlying container,
+// the default fits sequences with both ends like std::deque and std::list,
+// add specializations for the others
+//
+// everything is static and inline, so an operation compiles down to the container call
+template <class Container_>
+class ContainerAdapter
+{
+    typedef typename Container_::value_type Type;
+  public:
+    template <class... Args_>
+    static inline void addFront(Container_& container, Args_&&... args)
+    { container.emplace_front(std::forward<Args_>(args)...); }
+
+    template <class... Args_>
+    static inline void addBack(Container_& container, Args_&&... args)
+    { container.emplace_back(std::forward<Args_>(args)...); }
+
+    static inline void removeFront(Container_& container, Type& element)
+    {
+        element = container.front();
+        container.pop_front();
+    }
+
+    static inline void removeFront(Container_& container, Type&& element)
+    {
+        element = std::move(container.front());
+        container.pop_front();
+    }
+
+    static inline void removeBack(Container_& container, Type& element)
+    {
+        element = container.back();
+        container.pop_back();
+    }
+
+    static inline void removeBack(Container_& container, Type&& element)
+    {
+        element = std::move(container.back());
+        container.pop_back();
+    }
+
+    static inline void clear(Container_& container)
+    { container.clear(); }
+};
+
+} // end namespace detail
+
+} // end namespace ride
@@ -6,23 +6,77 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+
 #include <ride/concurrency/container/detail/container.hpp>
-#include <ride/concurrency/container/detail/bidirectional_operations.hpp>
+#include <ride/concurrency/container/detail/operations.hpp>
 
 namespace ride { namespace detail {
 
-template <class T_, class Container_>
+// add specializations for containers with a better way to erase
+template <class Container_>
+class Eraser
+{
+  public:
+    template <class Predicate_>
+    static inline std::size_t eraseIf(Container_& container, Predicate_& predicate)
+    {
+        auto removed = std::remove_if(container.begin(), container.end(), predicate);
+        std::size_t count = std::distance(removed, container.end());
+
+        container.erase(removed, container.end());
+        return count;
+    }
+};
+
+template <class T_, class Container_, class Derived_>
 class BidirectionalConcurrentContainer
-  : public ConcurrentContainer<T_, Container_>
-  , public BidirectionalLRefOperations<T_>
-  , public BidirectionalRRefOperations<T_>
-  , public BidirectionalEmplaceOperations<Container_>
+  : public ConcurrentContainer<T_, Container_, Derived_>
 {
-    inline Container_& getInternalData() override
-    { return this->data; }
+  protected:
+    typedef typename ConcurrentContainer<T_, Container_, Derived_>::Lock Lock;
   public:
-    using ConcurrentContainer<T_, Container_>::ConcurrentContainer;
-    virtual ~BidirectionalConcurrentContainer() = default;
+    using ConcurrentContainer<T_, Container_, Derived_>::ConcurrentContainer;
+
+    LRefAddOperation(pushFront, tryPushFront, unsafeAddFront)
+    RRefAddOperation(pushFront, tryPushFront, unsafeAddFront)
+    LRefRemoveOperation(popFront, tryPopFront, unsafeRemoveFront)
+    RRefRemoveOperation(popFront, tryPopFront, unsafeRemoveFront)
+    LRefAddOperation(pushBack, tryPushBack, unsafeAddBack)
+    RRefAddOperation(pushBack, tryPushBack, unsafeAddBack)
+    LRefRemoveOperation(popBack, tryPopBack, unsafeRemoveBack)
+    RRefRemoveOperation(popBack, tryPopBack, unsafeRemoveBack)
+
+    CreateOperation(emplaceFront, tryEmplaceFront, unsafeAddFront)
+    CreateOperation(emplaceBack, tryEmplaceBack, unsafeAddBack)
+
+    RangeAddOperation(pushFrontRange, tryPushFrontRange, unsafeAddFront)
+    RangeAddOperation(pushBackRange, tryPushBackRange, unsafeAddBack)
+    RangeRemoveOperation(popFrontN, tryPopFrontN, unsafeRemoveFront)
+    RangeRemoveOperation(popBackN, tryPopBackN, unsafeRemoveBack)
+    DrainOperation(drainTo, unsafeRemoveFront)
+
+    // visits every element front to back under a single lock
+    template <class Function_>
+    inline void forEach(Function_ function) const
+    {
+        this->withLock([&function](const Container_& data)
+        {
+            for (const T_& element : data)
+                function(element);
+        });
+    }
+
+    // returns how many elements matched
+    template <class Predicate_>
+    inline std::size_t removeIf(Predicate_ predicate)
+    {
+        return this->withLock([&predicate](Container_& data)
+        { return Eraser<Container_>::eraseIf(data, predicate); });
+    }
 };
 
 } // end namespace detail
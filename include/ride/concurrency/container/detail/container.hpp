@@ -6,43 +6,104 @@
 
 #pragma once
 
-#include <condition_variable>
-#include <functional>
 #include <mutex>
-#include <memory>
+#include <utility>
 
-#include <ride/concurrency/container/detail/container_types.hpp>
+#include <ride/concurrency/container/detail/adapter.hpp>
 #include <ride/concurrency/container/detail/safe_container.hpp>
 
 namespace ride { namespace detail {
 
-template <class T_, class Container_>
+// nothing here is virtual, Derived_ is the most derived container and everything
+// that depends on the underlying container goes through its ContainerAdapter,
+// so the leaf containers are final, a class deriving from one would be ignored
+template <class T_, class Container_, class Derived_>
 class ConcurrentContainer
-  : virtual protected SafeConcurrentContainer
+  : public SafeConcurrentContainer<Derived_>
 {
+    friend class SafeConcurrentContainer<Derived_>;
   public:
     typedef T_ Type;
     typedef Container_ ContainerType;
   protected:
-    typedef std::timed_mutex Mutex;
-    typedef std::unique_lock<Mutex> Lock;
+    typedef typename SafeConcurrentContainer<Derived_>::Mutex Mutex;
+    typedef typename SafeConcurrentContainer<Derived_>::Lock Lock;
     typedef std::lock_guard<Mutex> LockGuard;
+    typedef ContainerAdapter<Container_> Adapter;
 
     ContainerType data;
-  private:
-    inline bool wait(Lock&, std::try_to_lock_t) const final
+
+    // decides whether a remove may proceed, hide it in the derived container to hold removes back
+    inline bool wait(Lock&, std::try_to_lock_t) const
     { return !this->unsafeIsEmpty(); }
-  protected:
-    virtual bool unsafeIsEmpty() const = 0;
-    virtual std::size_t unsafeSize() const = 0;
-    virtual void unsafeClear() = 0;
+
+    inline bool waitForRoom(Lock&, std::try_to_lock_t) const
+    { return this->unsafeHasRoom(); }
+
+    inline bool unsafeIsEmpty() const
+    { return this->data.empty(); }
+
+    inline std::size_t unsafeSize() const
+    { return this->data.size(); }
+
+    inline void unsafeClear()
+    { Adapter::clear(this->data); }
+
+    template <class... Args_>
+    inline void unsafeAddFront(Args_&&... args)
+    { Adapter::addFront(this->data, std::forward<Args_>(args)...); }
+
+    template <class... Args_>
+    inline void unsafeAddBack(Args_&&... args)
+    { Adapter::addBack(this->data, std::forward<Args_>(args)...); }
+
+    inline void unsafeRemoveFront(T_& element)
+    { Adapter::removeFront(this->data, element); }
+
+    inline void unsafeRemoveFront(T_&& element)
+    { Adapter::removeFront(this->data, std::move(element)); }
+
+    inline void unsafeRemoveBack(T_& element)
+    { Adapter::removeBack(this->data, element); }
+
+    inline void unsafeRemoveBack(T_&& element)
+    { Adapter::removeBack(this->data, std::move(element)); }
+
+    inline bool unsafeHasRoom() const
+    {
+        std::size_t capacity = this->capacity.load(std::memory_order_relaxed);
+        return capacity == 0 || this->unsafeSize() < capacity;
+    }
+  private:
+    // wakes whoever may proceed after the data changed behind the operations' back,
+    // a container that didn't shrink may have new or reordered elements
+    class ChangeNotifier
+    {
+        ConcurrentContainer& container;
+        std::size_t size;
+      public:
+        explicit ChangeNotifier(ConcurrentContainer& container)
+          : container(container)
+          , size(container.unsafeSize())
+        { }
+
+        ~ChangeNotifier()
+        {
+            std::size_t size = this->container.unsafeSize();
+
+            if (size < this->size)
+                this->container.notifyRoom();
+            else
+                this->container.notifyElements();
+        }
+    };
   public:
     template <class... Args_>
     ConcurrentContainer(Args_&&... args)
       : data(args...)
     { }
 
-    virtual ~ConcurrentContainer() = default;
+    ~ConcurrentContainer() = default;
 
     inline bool isEmpty() const
     {
@@ -63,9 +124,68 @@ class ConcurrentContainer
         Lock lock(this->mutex);
 
         this->unsafeClear();
+        this->notifyRoom();
 
         lock.unlock();
     }
+
+    inline bool isFull() const
+    {
+        LockGuard lock(this->mutex);
+
+        return !this->unsafeHasRoom();
+    }
+
+    inline bool isBounded() const
+    { return this->capacity.load(std::memory_order_relaxed) != 0; }
+
+    inline std::size_t getCapacity() const
+    { return this->capacity.load(std::memory_order_relaxed); }
+
+    // adds wait for room once the container holds capacity elements, zero removes the bound
+    inline void setCapacity(std::size_t capacity)
+    {
+        Lock lock(this->mutex);
+
+        this->capacity.store(capacity, std::memory_order_relaxed);
+        this->notifyRoom();
+
+        lock.unlock();
+    }
+
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+    // signals the notifier whenever an add leaves elements in the container, and right
+    // away when it isn't empty, nullptr detaches it
+    //
+    // the notifier has to outlive being attached
+    inline void setNotifier(EventNotifier* notifier)
+    {
+        LockGuard lock(this->mutex);
+
+        this->notifier = notifier;
+        this->signalNotifier();
+    }
+#endif
+
+    // runs the function on the underlying container under a single lock, for several
+    // operations that must happen together, and wakes the waiters afterwards
+    // the result is returned by value, nothing inside the container may escape the lock
+    template <class Function_>
+    inline auto withLock(Function_ function)
+    {
+        LockGuard lock(this->mutex);
+        ChangeNotifier notifier(*this);
+
+        return function(this->data);
+    }
+
+    template <class Function_>
+    inline auto withLock(Function_ function) const
+    {
+        LockGuard lock(this->mutex);
+
+        return function(static_cast<const ContainerType&>(this->data));
+    }
 };
 
 } // end namespace detail
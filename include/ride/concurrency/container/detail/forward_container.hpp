@@ -6,23 +6,34 @@
 
 #pragma once
 
+#include <chrono>
+#include <iterator>
+#include <limits>
+
 #include <ride/concurrency/container/detail/container.hpp>
-#include <ride/concurrency/container/detail/forward_operations.hpp>
+#include <ride/concurrency/container/detail/operations.hpp>
 
 namespace ride { namespace detail {
 
-template <class T_, class Container_>
+template <class T_, class Container_, class Derived_>
 class ForwardConcurrentContainer
-  : public ConcurrentContainer<T_, Container_>
-  , public ForwardLRefOperations<T_>
-  , public ForwardRRefOperations<T_>
-  , public ForwardEmplaceOperations<Container_>
+  : public ConcurrentContainer<T_, Container_, Derived_>
 {
-    inline Container_& getInternalData() override
-    { return this->data; }
+  protected:
+    typedef typename ConcurrentContainer<T_, Container_, Derived_>::Lock Lock;
   public:
-    using ConcurrentContainer<T_, Container_>::ConcurrentContainer;
-    virtual ~ForwardConcurrentContainer() = default;
+    using ConcurrentContainer<T_, Container_, Derived_>::ConcurrentContainer;
+
+    LRefAddOperation(push, tryPush, unsafeAddFront)
+    RRefAddOperation(push, tryPush, unsafeAddFront)
+    LRefRemoveOperation(pop, tryPop, unsafeRemoveFront)
+    RRefRemoveOperation(pop, tryPop, unsafeRemoveFront)
+
+    CreateOperation(emplace, tryEmplace, unsafeAddFront)
+
+    RangeAddOperation(pushN, tryPushN, unsafeAddFront)
+    RangeRemoveOperation(popN, tryPopN, unsafeRemoveFront)
+    DrainOperation(drainTo, unsafeRemoveFront)
 };
 
 } // end namespace detail
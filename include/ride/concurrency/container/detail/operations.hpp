@@ -7,7 +7,7 @@
 #pragma once
 
 #define tryOperation(add_or_remove, op, timeout) \
-    LockPtr lock; \
+    Lock lock; \
     if (!this->prepareSafeTry##add_or_remove(lock, timeout)) \
         return false; \
     this->op; \
@@ -15,7 +15,7 @@
     return true;
 
 #define doOperation(add_or_remove, op) \
-    LockPtr lock; \
+    Lock lock; \
     this->prepareSafe##add_or_remove(lock); \
     this->op; \
     this->finishSafe##add_or_remove(lock);
@@ -50,4 +50,164 @@
 #define RRefAddOperation(name, tryName, op) AddOperation(name, tryName, T_&& element, op(std::move(element)))
 #define RRefRemoveOperation(name, tryName, op) RemoveOperation(name, tryName, T_&& element, op(std::move(element)))
 
-#define CreateOperation(name, tryName, op) templatedOperation(class... Args_, name, tryName, Add, Args_&&... args, op(std::forward<Args_>(args)...))
\ No newline at end of file
+#define CreateOperation(name, tryName, op) templatedOperation(class... Args_, name, tryName, Add, Args_&&... args, op(std::forward<Args_>(args)...))
+
+// range operations move every element they can under one lock and wake waiters once,
+// adds only wait for room again when a bounded container fills up part way through
+//
+// range removes and drains need a default constructible T_, each element is removed
+// into a local before it's written to out
+
+#define unsafeRangeAdd(op) \
+    for (; first != last && this->unsafeCanAdd(lock); ++first, ++added) \
+        this->op(*first);
+
+#define unsafeRangeRemove(op) \
+    for (; removed < max && this->unsafeCanRemove(lock); ++removed) \
+    { \
+        T_ element; \
+        this->op(std::move(element)); \
+        *out++ = std::move(element); \
+    }
+
+#define RangeAddOperation(name, tryName, op) \
+    template <class InputIt_> \
+    void name(InputIt_ first, InputIt_ last) \
+    { \
+        std::size_t added = 0; \
+        while (first != last) \
+        { \
+            Lock lock; \
+            this->prepareSafeAdd(lock); \
+            unsafeRangeAdd(op) \
+            this->finishSafeBulkAdd(lock); \
+        } \
+    } \
+    template <class InputIt_> \
+    std::size_t tryName(InputIt_ first, InputIt_ last) \
+    { \
+        std::size_t added = 0; \
+        Lock lock; \
+        if (first == last || !this->prepareSafeTryAdd(lock, std::try_to_lock)) \
+            return 0; \
+        unsafeRangeAdd(op) \
+        this->finishSafeBulkAdd(lock); \
+        return added; \
+    } \
+    template <class InputIt_, class Rep_, class Period_> \
+    std::size_t tryName##For(InputIt_ first, InputIt_ last, const std::chrono::duration<Rep_, Period_>& timeout_duration) \
+    { return this->tryName##Until(first, last, std::chrono::steady_clock::now() + timeout_duration); } \
+    template <class InputIt_, class Clock_, class Duration_> \
+    std::size_t tryName##Until(InputIt_ first, InputIt_ last, const std::chrono::time_point<Clock_, Duration_>& timeout_time) \
+    { \
+        std::size_t added = 0; \
+        while (first != last) \
+        { \
+            Lock lock; \
+            if (!this->prepareSafeTryAdd(lock, timeout_time)) \
+                break; \
+            unsafeRangeAdd(op) \
+            this->finishSafeBulkAdd(lock); \
+        } \
+        return added; \
+    }
+
+#define RangeRemoveOperation(name, tryName, op) \
+    template <class OutputIt_> \
+    std::size_t name(OutputIt_ out, std::size_t max) \
+    { \
+        std::size_t removed = 0; \
+        if (max == 0) \
+            return 0; \
+        Lock lock; \
+        this->prepareSafeRemove(lock); \
+        unsafeRangeRemove(op) \
+        this->finishSafeBulkRemove(lock); \
+        return removed; \
+    } \
+    template <class OutputIt_> \
+    std::size_t tryName(OutputIt_ out, std::size_t max) \
+    { tryRangeRemove(op, std::try_to_lock) } \
+    template <class OutputIt_, class Rep_, class Period_> \
+    std::size_t tryName##For(OutputIt_ out, std::size_t max, const std::chrono::duration<Rep_, Period_>& timeout_duration) \
+    { tryRangeRemove(op, timeout_duration) } \
+    template <class OutputIt_, class Clock_, class Duration_> \
+    std::size_t tryName##Until(OutputIt_ out, std::size_t max, const std::chrono::time_point<Clock_, Duration_>& timeout_time) \
+    { tryRangeRemove(op, timeout_time) }
+
+#define tryRangeRemove(op, timeout) \
+    std::size_t removed = 0; \
+    Lock lock; \
+    if (max == 0 || !this->prepareSafeTryRemove(lock, timeout)) \
+        return 0; \
+    unsafeRangeRemove(op) \
+    this->finishSafeBulkRemove(lock); \
+    return removed;
+
+// takes whatever is there without waiting, writing it to out, which can hand the
+// elements on to another concurrent container through a SinkIterator
+#define DrainOperation(name, op) \
+    template <class OutputIt_> \
+    std::size_t name(OutputIt_ out, std::size_t max = std::numeric_limits<std::size_t>::max()) \
+    { \
+        std::size_t removed = 0; \
+        Lock lock; \
+        this->prepareSafeDrain(lock); \
+        unsafeRangeRemove(op) \
+        this->finishSafeBulkRemove(lock); \
+        return removed; \
+    }
+
+// staged operations keep work that doesn't need the container out of the lock, an add
+// stages the element before locking and a remove finishes it after unlocking
+// a staged add that fails hands a moved element back through the failed clause
+
+#define tryStagedOperation(add_or_remove, before, op, failed, after, timeout) \
+    before; \
+    Lock lock; \
+    if (!this->prepareSafeTry##add_or_remove(lock, timeout)) \
+    { \
+        failed; \
+        return false; \
+    } \
+    this->op; \
+    this->finishSafe##add_or_remove(lock); \
+    after; \
+    return true;
+
+#define stagedOperation(basic_template, try_template, name, tryName, add_or_remove, type, before, op, failed, after) \
+    basic_template \
+    void name(type) \
+    { \
+        before; \
+        doOperation(add_or_remove, op) \
+        after; \
+    } \
+    basic_template \
+    bool tryName(type) \
+    { tryStagedOperation(add_or_remove, before, op, failed, after, std::try_to_lock) } \
+    template <try_template class Rep_, class Period_> \
+    bool tryName##For(type, const std::chrono::duration<Rep_, Period_>& timeout_duration) \
+    { tryStagedOperation(add_or_remove, before, op, failed, after, timeout_duration) } \
+    template <try_template class Clock_, class Duration_> \
+    bool tryName##Until(type, const std::chrono::time_point<Clock_, Duration_>& timeout_time) \
+    { tryStagedOperation(add_or_remove, before, op, failed, after, timeout_time) }
+
+#define StagedLRefAddOperation(name, tryName, stage, op) \
+    stagedOperation(, , name, tryName, Add, const T_& element, auto staged = this->stage(element), op(staged), , )
+
+#define StagedRRefAddOperation(name, tryName, stage, op, unstage) \
+    stagedOperation(, , name, tryName, Add, T_&& element, auto staged = this->stage(std::move(element)), op(staged), \
+                    this->unstage(staged, element), )
+
+#define StagedCreateOperation(name, tryName, stage, op) \
+    stagedOperation(template<class... Args_>, class... Args_ COMMA, name, tryName, Add, Args_&&... args, \
+                    auto staged = this->stage(std::forward<Args_>(args)...), op(staged), , )
+
+#define StagedLRefRemoveOperation(name, tryName, stage, op, unstage) \
+    stagedOperation(, , name, tryName, Remove, T_& element, auto staged = this->stage(), op(staged), , \
+                    this->unstage(staged, element))
+
+#define StagedRRefRemoveOperation(name, tryName, stage, op, unstage) \
+    stagedOperation(, , name, tryName, Remove, T_&& element, auto staged = this->stage(), op(staged), , \
+                    this->unstage(staged, element))
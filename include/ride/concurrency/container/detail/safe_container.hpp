@@ -6,98 +6,195 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
-#include <memory>
 #include <condition_variable>
 
+#include <ride/concurrency/detail/event_notifier.hpp>
+
 namespace ride { namespace detail {
 
+// Derived_ is the most derived container, its wait and waitForRoom decide whether
+// a remove or an add may proceed, resolved at compile time so they can be inlined
+template <class Derived_>
 class SafeConcurrentContainer
 {
   protected:
     typedef std::timed_mutex Mutex;
     typedef std::unique_lock<Mutex> Lock;
-    typedef std::unique_ptr<Lock> LockPtr;
 
     mutable Mutex mutex;
+    // zero means the container is unbounded
+    std::atomic_size_t capacity;
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+    // signalled under the mutex whenever an add leaves elements behind
+    EventNotifier* notifier;
+#endif
   private:
     std::condition_variable_any condition;
+    std::condition_variable_any room_condition;
+
+    inline bool canRemove(Lock& lock) const
+    { return static_cast<const Derived_&>(*this).wait(lock, std::try_to_lock); }
+
+    inline bool canAdd(Lock& lock) const
+    { return static_cast<const Derived_&>(*this).waitForRoom(lock, std::try_to_lock); }
 
-    inline void wait(Lock& lock)
+    inline void awaitElements(Lock& lock)
     {
-        while (!wait(lock, std::try_to_lock))
+        while (!this->canRemove(lock))
             this->condition.wait(lock);
     }
 
     template <class Clock_, class Duration_>
-    inline bool wait(Lock& lock, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    inline bool awaitElements(Lock& lock, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
     {
-        while (!wait(lock, std::try_to_lock))
+        while (!this->canRemove(lock))
             if (this->condition.wait_until(lock, timeout_time) == std::cv_status::timeout)
-                return wait(lock, std::try_to_lock);
+                return this->canRemove(lock);
         return true;
     }
 
-    virtual bool wait(Lock&, std::try_to_lock_t) const = 0;
-
-    inline void obtainLock(LockPtr& lock) const
-    { lock.reset(new Lock(this->mutex)); }
-
-    static bool resetLockIfNotOwned(LockPtr& lock)
+    inline void awaitRoom(Lock& lock)
     {
-        if (!lock->owns_lock())
-        {
-            lock.reset();
-            return false;
-        }
+        while (!this->canAdd(lock))
+            this->room_condition.wait(lock);
+    }
 
+    template <class Clock_, class Duration_>
+    inline bool awaitRoom(Lock& lock, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    {
+        while (!this->canAdd(lock))
+            if (this->room_condition.wait_until(lock, timeout_time) == std::cv_status::timeout)
+                return this->canAdd(lock);
         return true;
     }
 
+    // the lock lives on the caller's stack, only the mutex is taken here
     template <class Timeout_>
-    inline bool tryObtainLock(LockPtr& lock, Timeout_&& timeout) const
+    inline bool tryObtainLock(Lock& lock, Timeout_&& timeout) const
     {
-        lock.reset(new Lock(this->mutex, std::forward<Timeout_>(timeout)));
+        lock = Lock(this->mutex, std::forward<Timeout_>(timeout));
 
-        return resetLockIfNotOwned(lock);
+        return lock.owns_lock();
+    }
+  protected:
+    inline void signalNotifier()
+    {
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+        if (this->notifier && !static_cast<const Derived_&>(*this).unsafeIsEmpty())
+            this->notifier->signal();
+#endif
+    }
+
+    // wake everything waiting for room after an operation that freed an unknown amount
+    inline void notifyRoom()
+    { this->room_condition.notify_all(); }
+
+    // wake every remove after the condition checked by wait changed
+    inline void notifyElements()
+    {
+        this->condition.notify_all();
+        this->signalNotifier();
+    }
+
+    SafeConcurrentContainer()
+      : capacity(0)
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+      , notifier(nullptr)
+#endif
+    { }
+
+    ~SafeConcurrentContainer() = default;
+
+    inline void prepareSafeAdd(Lock& lock)
+    {
+        lock = Lock(this->mutex);
+        this->awaitRoom(lock);
     }
-  public:
-    inline void prepareSafeAdd(LockPtr& lock)
-    { obtainLock(lock); }
 
     template <class Timeout_>
-    inline bool prepareSafeTryAdd(LockPtr& lock, Timeout_&& timeout)
-    { return tryObtainLock(lock, std::forward<Timeout_>(timeout)); }
+    inline bool prepareSafeTryAdd(Lock& lock, Timeout_&& timeout)
+    {
+        return this->tryObtainLock(lock, std::forward<Timeout_>(timeout))
+                && this->awaitRoom(lock, std::forward<Timeout_>(timeout));
+    }
+
+    template <class Rep_, class Period_>
+    inline bool prepareSafeTryAdd(Lock& lock, const std::chrono::duration<Rep_, Period_>& duration)
+    {
+        // same double wait issue as prepareSafeTryRemove
+        return this->prepareSafeTryAdd(lock, std::chrono::steady_clock::now() + duration);
+    }
+
+    inline bool prepareSafeTryAdd(Lock& lock, std::try_to_lock_t)
+    { return this->tryObtainLock(lock, std::try_to_lock) && this->canAdd(lock); }
 
-    inline void prepareSafeRemove(LockPtr& lock)
+    inline void prepareSafeRemove(Lock& lock)
     {
-        obtainLock(lock);
-        this->wait(*lock);
+        lock = Lock(this->mutex);
+        this->awaitElements(lock);
     }
 
     template <class Timeout_>
-    inline bool prepareSafeTryRemove(LockPtr& lock, Timeout_&& timeout)
+    inline bool prepareSafeTryRemove(Lock& lock, Timeout_&& timeout)
     {
-        return tryObtainLock(lock, std::forward<Timeout_>(timeout))
-                && this->wait(*lock, std::forward<Timeout_>(timeout));
+        return this->tryObtainLock(lock, std::forward<Timeout_>(timeout))
+                && this->awaitElements(lock, std::forward<Timeout_>(timeout));
     }
 
     template <class Rep_, class Period_>
-    inline bool prepareSafeTryRemove(LockPtr& lock, const std::chrono::duration<Rep_, Period_>& duration)
+    inline bool prepareSafeTryRemove(Lock& lock, const std::chrono::duration<Rep_, Period_>& duration)
     {
         // fix issue of double wait (obtain lock and wait for insertion)
         // converts the duration into a time_point object
-        return prepareSafeTryRemove(lock, std::chrono::steady_clock::now() + duration);
+        return this->prepareSafeTryRemove(lock, std::chrono::steady_clock::now() + duration);
     }
 
-    inline void finishSafeAdd(LockPtr& lock)
+    inline bool prepareSafeTryRemove(Lock& lock, std::try_to_lock_t)
+    { return this->tryObtainLock(lock, std::try_to_lock) && this->canRemove(lock); }
+
+    inline void finishSafeAdd(Lock& lock)
     {
         this->condition.notify_one();
-        lock->unlock();
+        this->signalNotifier();
+        lock.unlock();
+    }
+
+    inline void finishSafeRemove(Lock& lock)
+    {
+        if (this->capacity.load(std::memory_order_relaxed))
+            this->room_condition.notify_one();
+        lock.unlock();
+    }
+
+    // range operations check the conditions themselves after every element
+    inline void prepareSafeDrain(Lock& lock)
+    { lock = Lock(this->mutex); }
+
+    inline bool unsafeCanAdd(Lock& lock) const
+    { return this->canAdd(lock); }
+
+    inline bool unsafeCanRemove(Lock& lock) const
+    { return this->canRemove(lock); }
+
+    inline void finishSafeBulkAdd(Lock& lock)
+    {
+        this->condition.notify_all();
+        this->signalNotifier();
+        lock.unlock();
     }
 
-    inline void finishSafeRemove(LockPtr& lock)
-    { lock->unlock(); }
+    inline void finishSafeBulkRemove(Lock& lock)
+    {
+        if (this->capacity.load(std::memory_order_relaxed))
+            this->room_condition.notify_all();
+        lock.unlock();
+    }
+  public:
+    SafeConcurrentContainer(const SafeConcurrentContainer&) = delete;
+    SafeConcurrentContainer& operator = (const SafeConcurrentContainer&) = delete;
 };
 
 } // end namespace detail
@@ -6,7 +6,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <list>
+#include <stdexcept>
 
 #include <ride/concurrency/container/detail/bidirectional_container.hpp>
 
@@ -14,80 +17,117 @@ namespace ride {
 
 namespace detail {
 
-template <class T_, class Alloc_, class... Args_>
-class Emplacer<std::list<T_, Alloc_>, Args_...>
-  : AbstractEmplacer<std::list<T_, Alloc_>>
-  , BasicForwardEmplacer<Args_...>
-  , BasicBackwardEmplacer<Args_...>
+template <class T_, class Alloc_>
+class Eraser<std::list<T_, Alloc_>>
 {
   public:
-    using AbstractEmplacer<std::list<T_, Alloc_>>::AbstractEmplacer;
-
-    inline void emplaceFront(Args_&&... args) override
+    // unlinks the nodes instead of moving the elements that stay
+    template <class Predicate_>
+    static inline std::size_t eraseIf(std::list<T_, Alloc_>& container, Predicate_& predicate)
     {
-        this->container.emplace_front(std::forward<Args_>(args)...);
-    }
+        std::size_t size = container.size();
 
-    inline void emplaceBack(Args_&&... args) override
-    {
-        this->container.emplace_back(std::forward<Args_>(args)...);
+        container.remove_if(predicate);
+        return size - container.size();
     }
 };
 
 } // end namespace detail
 
 template <class T_, class Alloc_ = std::allocator<T_>>
-class ConcurrentList
-  : public detail::BidirectionalConcurrentContainer<T_, std::list<T_, Alloc_>>
+class ConcurrentList final
+  : public detail::BidirectionalConcurrentContainer<T_, std::list<T_, Alloc_>, ConcurrentList<T_, Alloc_>>
 {
   private:
-    inline bool unsafeIsEmpty() const override
-    { return this->data.empty(); }
-
-    inline std::size_t unsafeSize() const override
-    { return this->data.size(); }
-
-    inline void unsafeClear() override
-    { this->data.clear(); }
-
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Winconsistent-missing-override"
-    inline void unsafeAddFront(const T_& element)
-    { this->data.push_front(element); }
-    inline void unsafeAddFront(T_&& element)
-    { this->data.push_front(std::move(element)); }
-    inline void unsafeAddBack(const T_& element)
-    { this->data.push_back(element); }
-    inline void unsafeAddBack(T_&& element)
-    { this->data.push_back(std::move(element)); }
-
-    inline void unsafeRemoveFront(T_& element)
-    {
-        element = this->data.front();
-        this->data.pop_front();
-    }
+    typedef std::list<T_, Alloc_> Nodes;
+    typedef typename detail::BidirectionalConcurrentContainer<T_, Nodes, ConcurrentList>::Lock Lock;
 
-    inline void unsafeRemoveFront(T_&& element)
+    // single elements are staged in a list of their own, so the node is allocated before
+    // locking and freed after unlocking, only the splice happens inside the lock
+    template <class... Args_>
+    inline Nodes stageNode(Args_&&... args)
     {
-        element = std::move(this->data.front());
-        this->data.pop_front();
+        Nodes staged(this->data.get_allocator());
+        staged.emplace_back(std::forward<Args_>(args)...);
+        return staged;
     }
 
-    inline void unsafeRemoveBack(T_& element)
-    {
-        element = this->data.back();
-        this->data.pop_back();
-    }
+    inline Nodes stageEmpty()
+    { return Nodes(this->data.get_allocator()); }
+
+    inline void unstageNode(Nodes& staged, T_& element)
+    { element = std::move(staged.front()); }
+
+    inline void unsafeLinkFront(Nodes& staged)
+    { this->data.splice(this->data.begin(), staged); }
+
+    inline void unsafeLinkBack(Nodes& staged)
+    { this->data.splice(this->data.end(), staged); }
+
+    inline void unsafeUnlinkFront(Nodes& staged)
+    { staged.splice(staged.end(), this->data, this->data.begin()); }
+
+    inline void unsafeUnlinkBack(Nodes& staged)
+    { staged.splice(staged.end(), this->data, std::prev(this->data.end())); }
 
-    inline void unsafeRemoveBack(T_&& element)
+    template <class Position_>
+    inline std::size_t splice(ConcurrentList& other, Position_ position)
     {
-        element = std::move(this->data.back());
-        this->data.pop_back();
+        if (&other == this)
+            return 0;
+
+        // the nodes would be freed through an allocator that didn't make them
+        if (this->data.get_allocator() != other.data.get_allocator())
+            throw std::invalid_argument("splicing between lists whose allocators differ");
+
+        // both lists locked at once, in whichever order avoids a deadlock with a splice the other way
+        Lock lock(this->mutex, std::defer_lock);
+        Lock other_lock(other.mutex, std::defer_lock);
+        std::lock(lock, other_lock);
+
+        std::size_t moved = other.data.size();
+        std::size_t capacity = this->getCapacity();
+
+        if (capacity != 0)
+            moved = std::min(moved, capacity > this->data.size() ? capacity - this->data.size() : 0);
+        if (moved == 0)
+            return 0;
+
+        if (moved == other.data.size())
+            this->data.splice(position(this->data), other.data);
+        else
+            this->data.splice(position(this->data), other.data, other.data.begin(), std::next(other.data.begin(), moved));
+
+        this->notifyElements();
+        other.notifyRoom();
+        return moved;
     }
-#pragma clang diagnostic pop
   public:
-    using detail::BidirectionalConcurrentContainer<T_, std::list<T_, Alloc_>>::BidirectionalConcurrentContainer;
-    virtual ~ConcurrentList() = default;
+    using detail::BidirectionalConcurrentContainer<T_, std::list<T_, Alloc_>, ConcurrentList<T_, Alloc_>>::BidirectionalConcurrentContainer;
+
+    StagedLRefAddOperation(pushFront, tryPushFront, stageNode, unsafeLinkFront)
+    StagedRRefAddOperation(pushFront, tryPushFront, stageNode, unsafeLinkFront, unstageNode)
+    StagedLRefAddOperation(pushBack, tryPushBack, stageNode, unsafeLinkBack)
+    StagedRRefAddOperation(pushBack, tryPushBack, stageNode, unsafeLinkBack, unstageNode)
+    StagedLRefRemoveOperation(popFront, tryPopFront, stageEmpty, unsafeUnlinkFront, unstageNode)
+    StagedRRefRemoveOperation(popFront, tryPopFront, stageEmpty, unsafeUnlinkFront, unstageNode)
+    StagedLRefRemoveOperation(popBack, tryPopBack, stageEmpty, unsafeUnlinkBack, unstageNode)
+    StagedRRefRemoveOperation(popBack, tryPopBack, stageEmpty, unsafeUnlinkBack, unstageNode)
+
+    StagedCreateOperation(emplaceFront, tryEmplaceFront, stageNode, unsafeLinkFront)
+    StagedCreateOperation(emplaceBack, tryEmplaceBack, stageNode, unsafeLinkBack)
+
+    // moves the elements of the other list in front of this one's, returning how many,
+    // in constant time unless this list is bounded, then only the other's first
+    // elements that fit are moved, in time linear in their number
+    //
+    // throws std::invalid_argument when the allocators of both lists don't compare equal
+    inline std::size_t spliceFront(ConcurrentList& other)
+    { return this->splice(other, [](std::list<T_, Alloc_>& data) { return data.begin(); }); }
+
+    // same as spliceFront, but after this list's elements
+    inline std::size_t spliceBack(ConcurrentList& other)
+    { return this->splice(other, [](std::list<T_, Alloc_>& data) { return data.end(); }); }
 };
 
 } // end namespace ride
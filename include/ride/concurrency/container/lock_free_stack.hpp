@@ -0,0 +1,260 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
+#include <ride/concurrency/detail/hazard_pointer.hpp>
+
+namespace ride {
+
+// a Treiber stack, pushes and pops are a single compare and swap on the head
+//
+// when the head is contended a push and a pop can meet in the elimination array
+// and hand the element over without touching the head, popped nodes are freed
+// through hazard pointers
+//
+// unbounded, and the size isn't tracked since a shared counter would be contended again
+//
+// with EliminateFirst_ pushes and pops meet in the elimination array before trying
+// the head, for stacks that are always contended
+template <class T_, std::size_t EliminationSlots_ = 8, bool EliminateFirst_ = false>
+class ConcurrentLockFreeStack
+{
+    static_assert(EliminationSlots_ > 0, "the elimination array needs at least one slot");
+
+    struct Node
+    {
+        T_ value;
+        Node* next;
+
+        template <class... Args_>
+        Node(Args_&&... args)
+          : value(std::forward<Args_>(args)...)
+          , next(nullptr)
+        { }
+    };
+
+    // padded so a busy slot doesn't slow down the head or its neighbours
+    struct Slot
+    {
+        std::atomic<Node*> node;
+        char padding[detail::cacheLineSize - sizeof(std::atomic<Node*>)];
+
+        Slot()
+          : node(nullptr)
+        { }
+    };
+
+    std::atomic<Node*> head;
+    char head_padding[detail::cacheLineSize - sizeof(std::atomic<Node*>)];
+    std::array<Slot, EliminationSlots_> slots;
+    detail::EventCount not_empty;
+
+    // how long a push waits in a slot for a pop to take it
+    static constexpr int eliminationSpins = 64;
+
+    // left in a slot by the pop that took its node, until the push sees it
+    static inline Node* taken()
+    {
+        static char marker;
+        return reinterpret_cast<Node*>(&marker);
+    }
+
+    static inline std::size_t randomSlot()
+    {
+        static thread_local std::uint32_t state = 0x9e3779b9u
+                ^ static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&state));
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % EliminationSlots_;
+    }
+
+    inline bool tryPushHead(Node* node)
+    {
+        Node* top = this->head.load(std::memory_order_relaxed);
+        node->next = top;
+        return this->head.compare_exchange_strong(top, node, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    // returns true once a pop has taken the node
+    inline bool tryEliminatePush(Node* node)
+    {
+        Slot& slot = this->slots[randomSlot()];
+        Node* empty = nullptr;
+
+        if (!slot.node.compare_exchange_strong(empty, node, std::memory_order_release, std::memory_order_relaxed))
+            return false;
+
+        for (int i = 0; i < eliminationSpins; ++i)
+            if (slot.node.load(std::memory_order_acquire) == taken())
+            {
+                slot.node.store(nullptr, std::memory_order_release);
+                return true;
+            }
+
+        // nobody came, take the node back unless a pop got it at the last moment
+        //
+        // a pop leaves the slot taken until this push frees it, so the node can't have been
+        // popped, freed and offered again at the same address by another push, acquire like
+        // the pop's since whichever side wins the slot goes on to use the node
+        Node* offered = node;
+        if (slot.node.compare_exchange_strong(offered, nullptr, std::memory_order_acquire, std::memory_order_relaxed))
+            return false;
+
+        slot.node.store(nullptr, std::memory_order_release);
+        return true;
+    }
+
+    // a node taken from a slot never reached the head, so nobody else can be reading it
+    inline Node* tryEliminatePop()
+    {
+        Slot& slot = this->slots[randomSlot()];
+        Node* node = slot.node.load(std::memory_order_relaxed);
+
+        if (node && node != taken()
+                && slot.node.compare_exchange_strong(node, taken(), std::memory_order_acquire, std::memory_order_relaxed))
+            return node;
+        return nullptr;
+    }
+
+    inline void pushNode(Node* node)
+    {
+        if (EliminateFirst_ && this->tryEliminatePush(node))
+            return;
+
+        while (!this->tryPushHead(node))
+            if (this->tryEliminatePush(node))
+                return;
+
+        this->not_empty.notifyOne();
+    }
+
+    // other pops may still be reading a node that was on the stack, so it is retired
+    inline bool tryPopNode(T_& element)
+    {
+        detail::HazardPointer hazard;
+
+        while (true)
+        {
+            if (EliminateFirst_)
+                if (Node* node = this->tryEliminatePop())
+                {
+                    element = std::move(node->value);
+                    delete node;
+                    return true;
+                }
+
+            Node* top = hazard.protect(this->head);
+            if (!top)
+                return false;
+
+            if (this->head.compare_exchange_strong(top, top->next, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                hazard.clear();
+                element = std::move(top->value);
+                detail::HazardPointer::retire(top);
+                return true;
+            }
+
+            if (Node* node = this->tryEliminatePop())
+            {
+                hazard.clear();
+                element = std::move(node->value);
+                delete node;
+                return true;
+            }
+        }
+    }
+
+    template <class Clock_, class Duration_>
+    inline bool waitPop(T_& element, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+        while (!this->tryPopNode(element))
+        {
+            detail::EventCount::Key key = this->not_empty.prepareWait();
+
+            if (this->tryPopNode(element))
+            {
+                this->not_empty.cancelWait();
+                return true;
+            }
+
+            if (!timeout_time)
+                this->not_empty.wait(key);
+            else if (!this->not_empty.waitUntil(key, *timeout_time))
+                return this->tryPopNode(element);
+        }
+
+        return true;
+    }
+  public:
+    ConcurrentLockFreeStack()
+      : head(nullptr)
+    { }
+
+    ConcurrentLockFreeStack(const ConcurrentLockFreeStack&) = delete;
+    ConcurrentLockFreeStack& operator = (const ConcurrentLockFreeStack&) = delete;
+
+    // no other thread may be using the stack anymore
+    virtual ~ConcurrentLockFreeStack()
+    {
+        Node* node = this->head.load(std::memory_order_relaxed);
+
+        while (node)
+        {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    inline void push(const T_& element)
+    { this->pushNode(new Node(element)); }
+
+    inline void push(T_&& element)
+    { this->pushNode(new Node(std::move(element))); }
+
+    template <class... Args_>
+    inline void emplace(Args_&&... args)
+    { this->pushNode(new Node(std::forward<Args_>(args)...)); }
+
+    // waits until an element is pushed
+    inline void pop(T_& element)
+    { this->waitPop<std::chrono::steady_clock, std::chrono::steady_clock::duration>(element, nullptr); }
+
+    inline void pop(T_&& element)
+    { this->pop(element); }
+
+    inline bool tryPop(T_& element)
+    { return this->tryPopNode(element); }
+
+    inline bool tryPop(T_&& element)
+    { return this->tryPopNode(element); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPopFor(T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPopUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPopUntil(T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return this->waitPop(element, &timeout_time); }
+
+    // only a snapshot, another thread may push or pop right after
+    inline bool isEmpty() const
+    { return this->head.load(std::memory_order_acquire) == nullptr; }
+};
+
+} // end namespace ride
@@ -0,0 +1,215 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ride {
+
+namespace detail {
+
+// free blocks of one size, cached per thread and passed between threads in batches
+//
+// a thread frees into its own cache and hands a batch to the shared pool once it
+// holds too many, a thread that runs out takes a batch back, so a producer and a
+// consumer on different threads only meet at the pool once per batch
+//
+// blocks are carved out of chunks that are never given back to the system
+template <std::size_t Size_>
+class NodeCache
+{
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static constexpr std::size_t batchSize = 32;
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+    static constexpr std::size_t blockSize = ((Size_ < sizeof(FreeBlock) ? sizeof(FreeBlock) : Size_) + alignment - 1)
+                                             / alignment * alignment;
+
+    struct Batch
+    {
+        FreeBlock* head;
+        std::size_t count;
+    };
+
+    struct Pool
+    {
+        std::mutex mutex;
+        std::vector<Batch> batches;
+    };
+
+    // never destroyed, threads may still be exiting while statics are torn down
+    static inline Pool& pool()
+    {
+        static Pool* pool = new Pool();
+        return *pool;
+    }
+
+    static inline void give(Batch batch)
+    {
+        Pool& pool = NodeCache::pool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+
+        pool.batches.push_back(batch);
+    }
+
+    struct Cache
+    {
+        FreeBlock* head;
+        std::size_t count;
+
+        Cache()
+          : head(nullptr)
+          , count(0)
+        { }
+
+        // the thread is exiting, its blocks go back to the pool
+        ~Cache()
+        {
+            if (this->head)
+                give(Batch { this->head, this->count });
+        }
+
+        inline void refill()
+        {
+            {
+                Pool& pool = NodeCache::pool();
+                std::lock_guard<std::mutex> lock(pool.mutex);
+
+                if (!pool.batches.empty())
+                {
+                    Batch batch = pool.batches.back();
+                    pool.batches.pop_back();
+
+                    this->head = batch.head;
+                    this->count = batch.count;
+                    return;
+                }
+            }
+
+            char* chunk = static_cast<char*>(::operator new(blockSize * batchSize));
+
+            for (std::size_t i = batchSize; i-- > 0;)
+            {
+                FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+                block->next = this->head;
+                this->head = block;
+            }
+
+            this->count = batchSize;
+        }
+
+        // keeps one batch around so a thread alternating between freeing and allocating doesn't bounce
+        inline void spill()
+        {
+            FreeBlock* head = this->head;
+            FreeBlock* last = head;
+
+            for (std::size_t i = 1; i < batchSize; ++i)
+                last = last->next;
+
+            this->head = last->next;
+            this->count -= batchSize;
+
+            last->next = nullptr;
+            give(Batch { head, batchSize });
+        }
+    };
+
+    static inline Cache& cache()
+    {
+        static thread_local Cache cache;
+        return cache;
+    }
+  public:
+    static inline void* allocate()
+    {
+        Cache& cache = NodeCache::cache();
+
+        if (!cache.head)
+            cache.refill();
+
+        FreeBlock* block = cache.head;
+        cache.head = block->next;
+        --cache.count;
+        return block;
+    }
+
+    static inline void deallocate(void* pointer)
+    {
+        Cache& cache = NodeCache::cache();
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+
+        block->next = cache.head;
+        cache.head = block;
+
+        if (++cache.count >= 2 * batchSize)
+            cache.spill();
+    }
+};
+
+} // end namespace detail
+
+// an allocator for node based containers like ConcurrentList, single objects come from
+// a thread cached pool of blocks and everything else goes straight to operator new
+//
+// stateless, so any two compare equal and lists using it can splice into each other
+template <class T_>
+class NodePoolAllocator
+{
+    static_assert(alignof(T_) <= alignof(std::max_align_t), "over aligned types aren't supported");
+
+    typedef detail::NodeCache<sizeof(T_)> Cache;
+  public:
+    typedef T_ value_type;
+
+    NodePoolAllocator() = default;
+
+    template <class U_>
+    NodePoolAllocator(const NodePoolAllocator<U_>&)
+    { }
+
+    inline T_* allocate(std::size_t n)
+    {
+        if (n == 1)
+            return static_cast<T_*>(Cache::allocate());
+
+        // the size in bytes would wrap around
+        if (n > this->max_size())
+            throw std::bad_array_new_length();
+
+        return static_cast<T_*>(::operator new(n * sizeof(T_)));
+    }
+
+    inline void deallocate(T_* pointer, std::size_t n)
+    {
+        if (n == 1)
+            Cache::deallocate(pointer);
+        else
+            ::operator delete(pointer);
+    }
+
+    inline std::size_t max_size() const
+    { return std::numeric_limits<std::size_t>::max() / sizeof(T_); }
+};
+
+template <class T_, class U_>
+inline bool operator == (const NodePoolAllocator<T_>&, const NodePoolAllocator<U_>&)
+{ return true; }
+
+template <class T_, class U_>
+inline bool operator != (const NodePoolAllocator<T_>&, const NodePoolAllocator<U_>&)
+{ return false; }
+
+} // end namespace ride
@@ -0,0 +1,46 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+// the containers forward their constructor arguments to the underlying container,
+// so these take a std::pmr::memory_resource* or a polymorphic_allocator directly
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+
+#include <functional>
+#include <memory_resource>
+
+#include <ride/concurrency/container/deque.hpp>
+#include <ride/concurrency/container/list.hpp>
+#include <ride/concurrency/container/priority_queue.hpp>
+#include <ride/concurrency/container/queue.hpp>
+#include <ride/concurrency/container/stack.hpp>
+
+namespace ride { namespace pmr {
+
+template <class T_>
+using ConcurrentDeque = ride::ConcurrentDeque<T_, std::pmr::polymorphic_allocator<T_>>;
+
+template <class T_>
+using ConcurrentList = ride::ConcurrentList<T_, std::pmr::polymorphic_allocator<T_>>;
+
+template <class T_, class Compare_ = std::less<T_>>
+using ConcurrentPriorityQueue = ride::ConcurrentPriorityQueue<T_, Compare_, std::pmr::polymorphic_allocator<T_>>;
+
+template <class T_>
+using ConcurrentQueue = ride::ConcurrentQueue<T_, std::pmr::polymorphic_allocator<T_>>;
+
+template <class T_>
+using ConcurrentStack = ride::ConcurrentStack<T_, std::pmr::polymorphic_allocator<T_>>;
+
+} // end namespace pmr
+
+} // end namespace ride
+
+#endif
+#endif
@@ -0,0 +1,326 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <ride/concurrency/container/detail/forward_container.hpp>
+#include <ride/concurrency/detail/cache_line.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
+
+namespace ride {
+
+namespace detail {
+
+template <class T_, class BaseContainer_, class Compare_>
+class ContainerAdapter<std::priority_queue<T_, BaseContainer_, Compare_>>
+{
+    typedef std::priority_queue<T_, BaseContainer_, Compare_> Container;
+  public:
+    template <class... Args_>
+    static inline void addFront(Container& container, Args_&&... args)
+    { container.emplace(std::forward<Args_>(args)...); }
+
+    static inline void removeFront(Container& container, T_& element)
+    {
+        element = container.top();
+        container.pop();
+    }
+
+    // the top is only const so the heap can't be broken through it, it is popped right after
+    static inline void removeFront(Container& container, T_&& element)
+    {
+        element = std::move(const_cast<T_&>(container.top()));
+        container.pop();
+    }
+
+    static inline void clear(Container& container)
+    {
+        while (!container.empty())
+            container.pop();
+    }
+};
+
+} // end namespace detail
+
+// the strict mode, every pop returns the greatest element by Compare_
+// behind a single lock, so each push and pop is O(log n) inside one critical section
+template <class T_, class Compare_ = std::less<T_>, class Alloc_ = std::allocator<T_>>
+class ConcurrentPriorityQueue final
+  : public detail::ForwardConcurrentContainer<T_, std::priority_queue<T_, std::vector<T_, Alloc_>, Compare_>,
+                                              ConcurrentPriorityQueue<T_, Compare_, Alloc_>>
+{
+  public:
+    using detail::ForwardConcurrentContainer<T_, std::priority_queue<T_, std::vector<T_, Alloc_>, Compare_>,
+                                             ConcurrentPriorityQueue<T_, Compare_, Alloc_>>::ForwardConcurrentContainer;
+};
+
+// the relaxed mode, a MultiQueue of several heaps with their own locks
+//
+// a push goes to a random heap and a pop takes the better top of two random heaps,
+// so a pop returns one of the greatest elements rather than the greatest, in exchange
+// pushes and pops on different heaps never wait on each other
+//
+// a pop only reports the queue as empty after finding every heap empty
+template <class T_, class Compare_ = std::less<T_>, class Alloc_ = std::allocator<T_>>
+class ConcurrentRelaxedPriorityQueue
+{
+    // padded on both sides so neighbouring heaps never share a cache line
+    struct Heap
+    {
+        char front_padding[detail::cacheLineSize];
+        std::mutex mutex;
+        std::vector<T_, Alloc_> data;
+        // read without the lock to skip empty heaps
+        std::atomic_size_t count;
+        char back_padding[detail::cacheLineSize];
+
+        Heap()
+          : count(0)
+        { }
+    };
+
+    typedef std::unique_lock<std::mutex> Lock;
+
+    std::size_t num_heaps;
+    std::unique_ptr<Heap[]> heaps;
+    Compare_ compare;
+    detail::EventCount not_empty;
+
+    static inline std::size_t randomIndex(std::size_t bound)
+    {
+        static thread_local std::uint32_t state = 0x9e3779b9u
+                ^ static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&state));
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % bound;
+    }
+
+    // the heap must be locked
+    template <class... Args_>
+    inline void pushLocked(Heap& heap, Args_&&... args)
+    {
+        heap.data.emplace_back(std::forward<Args_>(args)...);
+        std::push_heap(heap.data.begin(), heap.data.end(), this->compare);
+        heap.count.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // the heap must be locked and not empty
+    inline void popLocked(Heap& heap, T_& element)
+    {
+        std::pop_heap(heap.data.begin(), heap.data.end(), this->compare);
+        element = std::move(heap.data.back());
+        heap.data.pop_back();
+        heap.count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <class... Args_>
+    inline void create(Args_&&... args)
+    {
+        // skip heaps somebody else is using, but don't go looking forever
+        for (std::size_t attempt = 0; attempt < this->num_heaps; ++attempt)
+        {
+            Heap& heap = this->heaps[randomIndex(this->num_heaps)];
+            Lock lock(heap.mutex, std::try_to_lock);
+
+            if (lock.owns_lock())
+            {
+                this->pushLocked(heap, std::forward<Args_>(args)...);
+                lock.unlock();
+                this->not_empty.notifyOne();
+                return;
+            }
+        }
+
+        Heap& heap = this->heaps[randomIndex(this->num_heaps)];
+
+        {
+            Lock lock(heap.mutex);
+            this->pushLocked(heap, std::forward<Args_>(args)...);
+        }
+
+        this->not_empty.notifyOne();
+    }
+
+    // compares the tops of two random heaps and pops the better one
+    inline bool tryRemoveRandom(T_& element)
+    {
+        Heap& first = this->heaps[randomIndex(this->num_heaps)];
+        Heap& second = this->heaps[randomIndex(this->num_heaps)];
+
+        if (&first == &second || second.count.load(std::memory_order_seq_cst) == 0)
+            return this->tryRemoveFrom(first, element);
+        if (first.count.load(std::memory_order_seq_cst) == 0)
+            return this->tryRemoveFrom(second, element);
+
+        Lock first_lock(first.mutex, std::try_to_lock);
+        if (!first_lock.owns_lock())
+            return this->tryRemoveFrom(second, element);
+
+        Lock second_lock(second.mutex, std::try_to_lock);
+        if (!second_lock.owns_lock() || second.data.empty())
+        {
+            if (first.data.empty())
+                return false;
+
+            this->popLocked(first, element);
+            return true;
+        }
+
+        if (first.data.empty() || this->compare(first.data.front(), second.data.front()))
+            this->popLocked(second, element);
+        else
+            this->popLocked(first, element);
+        return true;
+    }
+
+    inline bool tryRemoveFrom(Heap& heap, T_& element)
+    {
+        if (heap.count.load(std::memory_order_seq_cst) == 0)
+            return false;
+
+        Lock lock(heap.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || heap.data.empty())
+            return false;
+
+        this->popLocked(heap, element);
+        return true;
+    }
+
+    inline bool tryRemove(T_& element)
+    {
+        for (std::size_t attempt = 0; attempt < this->num_heaps; ++attempt)
+            if (this->tryRemoveRandom(element))
+                return true;
+
+        // the random picks keep missing, sweep every heap before calling it empty
+        for (std::size_t i = 0; i < this->num_heaps; ++i)
+        {
+            Heap& heap = this->heaps[i];
+
+            if (heap.count.load(std::memory_order_seq_cst) == 0)
+                continue;
+
+            Lock lock(heap.mutex);
+
+            if (heap.data.empty())
+                continue;
+
+            this->popLocked(heap, element);
+            return true;
+        }
+
+        return false;
+    }
+
+    template <class Clock_, class Duration_>
+    inline bool waitRemove(T_& element, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+        while (!this->tryRemove(element))
+        {
+            detail::EventCount::Key key = this->not_empty.prepareWait();
+
+            if (this->tryRemove(element))
+            {
+                this->not_empty.cancelWait();
+                return true;
+            }
+
+            if (!timeout_time)
+                this->not_empty.wait(key);
+            else if (!this->not_empty.waitUntil(key, *timeout_time))
+                return this->tryRemove(element);
+        }
+
+        return true;
+    }
+  public:
+    typedef T_ Type;
+
+    // heaps_per_thread is the c in c times the number of hardware threads,
+    // more heaps means less contention but pops further from the greatest element
+    explicit ConcurrentRelaxedPriorityQueue(std::size_t heaps_per_thread = 2, const Compare_& compare = Compare_())
+      : num_heaps(std::max<std::size_t>(heaps_per_thread, 1) * std::max(std::thread::hardware_concurrency(), 1u))
+      , heaps(new Heap[this->num_heaps])
+      , compare(compare)
+    { }
+
+    ConcurrentRelaxedPriorityQueue(const ConcurrentRelaxedPriorityQueue&) = delete;
+    ConcurrentRelaxedPriorityQueue& operator = (const ConcurrentRelaxedPriorityQueue&) = delete;
+    virtual ~ConcurrentRelaxedPriorityQueue() = default;
+
+    inline void push(const T_& element)
+    { this->create(element); }
+
+    inline void push(T_&& element)
+    { this->create(std::move(element)); }
+
+    template <class... Args_>
+    inline void emplace(Args_&&... args)
+    { this->create(std::forward<Args_>(args)...); }
+
+    // waits until an element is pushed
+    inline void pop(T_& element)
+    { this->waitRemove<std::chrono::steady_clock, std::chrono::steady_clock::duration>(element, nullptr); }
+
+    inline void pop(T_&& element)
+    { this->pop(element); }
+
+    inline bool tryPop(T_& element)
+    { return this->tryRemove(element); }
+
+    inline bool tryPop(T_&& element)
+    { return this->tryRemove(element); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPopFor(T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPopUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPopUntil(T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return this->waitRemove(element, &timeout_time); }
+
+    // the sum of the heaps, which may have changed by the time it returns
+    inline std::size_t size() const
+    {
+        std::size_t total = 0;
+
+        for (std::size_t i = 0; i < this->num_heaps; ++i)
+            total += this->heaps[i].count.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    inline bool isEmpty() const
+    { return this->size() == 0; }
+
+    inline void clear()
+    {
+        for (std::size_t i = 0; i < this->num_heaps; ++i)
+        {
+            std::lock_guard<std::mutex> lock(this->heaps[i].mutex);
+
+            this->heaps[i].data.clear();
+            this->heaps[i].count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::size_t numHeaps() const
+    { return this->num_heaps; }
+};
+
+} // end namespace ride
@@ -0,0 +1,193 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
+
+namespace ride {
+
+// a queue split into shards with their own locks, for many producers feeding it at once
+//
+// a thread always pushes to its own home shard and consumers sweep every shard
+// starting at theirs, so order is only kept per producer: elements pushed by one
+// thread are popped in the order they were pushed, elements of different threads
+// may be popped in any order
+template <class T_, class Alloc_ = std::allocator<T_>>
+class ConcurrentShardedQueue
+{
+    // padded on both sides so neighbouring shards never share a cache line
+    struct Shard
+    {
+        char front_padding[detail::cacheLineSize];
+        std::mutex mutex;
+        std::deque<T_, Alloc_> data;
+        // read without the lock to skip empty shards
+        std::atomic_size_t count;
+        char back_padding[detail::cacheLineSize];
+
+        Shard()
+          : count(0)
+        { }
+    };
+
+    std::size_t num_shards;
+    std::unique_ptr<Shard[]> shards;
+    detail::EventCount not_empty;
+
+    // threads get consecutive home shards in the order they first use any sharded queue
+    static inline std::size_t homeIndex()
+    {
+        static std::atomic_size_t next_home(0);
+        static thread_local std::size_t home = next_home.fetch_add(1, std::memory_order_relaxed);
+        return home;
+    }
+
+    inline Shard& homeShard()
+    { return this->shards[homeIndex() % this->num_shards]; }
+
+    template <class... Args_>
+    inline void create(Args_&&... args)
+    {
+        Shard& shard = this->homeShard();
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            shard.data.emplace_back(std::forward<Args_>(args)...);
+            shard.count.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        this->not_empty.notifyOne();
+    }
+
+    inline bool tryRemove(T_& element)
+    {
+        std::size_t start = homeIndex();
+
+        for (std::size_t i = 0; i < this->num_shards; ++i)
+        {
+            Shard& shard = this->shards[(start + i) % this->num_shards];
+
+            if (shard.count.load(std::memory_order_seq_cst) == 0)
+                continue;
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            if (shard.data.empty())
+                continue;
+
+            element = std::move(shard.data.front());
+            shard.data.pop_front();
+            shard.count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        return false;
+    }
+
+    template <class Clock_, class Duration_>
+    inline bool waitRemove(T_& element, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+        while (!this->tryRemove(element))
+        {
+            detail::EventCount::Key key = this->not_empty.prepareWait();
+
+            if (this->tryRemove(element))
+            {
+                this->not_empty.cancelWait();
+                return true;
+            }
+
+            if (!timeout_time)
+                this->not_empty.wait(key);
+            else if (!this->not_empty.waitUntil(key, *timeout_time))
+                return this->tryRemove(element);
+        }
+
+        return true;
+    }
+  public:
+    typedef T_ Type;
+
+    explicit ConcurrentShardedQueue(std::size_t num_shards = std::max(std::thread::hardware_concurrency(), 1u))
+      : num_shards(std::max<std::size_t>(num_shards, 1))
+      , shards(new Shard[this->num_shards])
+    { }
+
+    ConcurrentShardedQueue(const ConcurrentShardedQueue&) = delete;
+    ConcurrentShardedQueue& operator = (const ConcurrentShardedQueue&) = delete;
+    virtual ~ConcurrentShardedQueue() = default;
+
+    inline void push(const T_& element)
+    { this->create(element); }
+
+    inline void push(T_&& element)
+    { this->create(std::move(element)); }
+
+    template <class... Args_>
+    inline void emplace(Args_&&... args)
+    { this->create(std::forward<Args_>(args)...); }
+
+    // waits until an element is pushed
+    inline void pop(T_& element)
+    { this->waitRemove<std::chrono::steady_clock, std::chrono::steady_clock::duration>(element, nullptr); }
+
+    inline void pop(T_&& element)
+    { this->pop(element); }
+
+    inline bool tryPop(T_& element)
+    { return this->tryRemove(element); }
+
+    inline bool tryPop(T_&& element)
+    { return this->tryRemove(element); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPopFor(T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPopUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPopUntil(T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return this->waitRemove(element, &timeout_time); }
+
+    // the sum of the shards, which may have changed by the time it returns
+    inline std::size_t size() const
+    {
+        std::size_t total = 0;
+
+        for (std::size_t i = 0; i < this->num_shards; ++i)
+            total += this->shards[i].count.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    inline bool isEmpty() const
+    { return this->size() == 0; }
+
+    inline void clear()
+    {
+        for (std::size_t i = 0; i < this->num_shards; ++i)
+        {
+            std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+
+            this->shards[i].data.clear();
+            this->shards[i].count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::size_t numShards() const
+    { return this->num_shards; }
+};
+
+} // end namespace ride
@@ -0,0 +1,53 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace ride {
+
+// an output iterator handing every element written to it to a callable, so range removes
+// and drains can feed a container that has no push_back, like another concurrent one
+template <class Sink_>
+class SinkIterator
+{
+    Sink_ sink;
+  public:
+    typedef std::output_iterator_tag iterator_category;
+    typedef void value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef void pointer;
+    typedef void reference;
+
+    explicit SinkIterator(Sink_ sink)
+      : sink(std::move(sink))
+    { }
+
+    template <class T_>
+    inline SinkIterator& operator = (T_&& element)
+    {
+        this->sink(std::forward<T_>(element));
+        return *this;
+    }
+
+    inline SinkIterator& operator * ()
+    { return *this; }
+
+    inline SinkIterator& operator ++ ()
+    { return *this; }
+
+    inline SinkIterator& operator ++ (int)
+    { return *this; }
+};
+
+template <class Sink_>
+inline SinkIterator<Sink_> makeSinkIterator(Sink_ sink)
+{ return SinkIterator<Sink_>(std::move(sink)); }
+
+} // end namespace ride
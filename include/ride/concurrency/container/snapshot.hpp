@@ -0,0 +1,93 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <ride/concurrency/detail/rcu.hpp>
+
+namespace ride {
+
+// a value for read mostly data, readers get an immutable snapshot and writers publish new versions
+//
+// a snapshot stays valid while the reading thread is online in the domain, for workers of
+// an RcuThreadPool that is until the end of the current job, and old versions are deleted
+// once every reader has moved past them
+//
+// writers are serialized and copy the whole value, so this is for data that rarely changes
+template <class T_>
+class ConcurrentSnapshot
+{
+    detail::RcuDomain& domain;
+    std::atomic<const T_*> current;
+    std::mutex writer_mutex;
+
+    // the writer lock must be held, returns the version to retire
+    inline const T_* unsafePublish(const T_* value)
+    { return this->current.exchange(value, std::memory_order_seq_cst); }
+  public:
+    typedef T_ Type;
+
+    template <class... Args_>
+    explicit ConcurrentSnapshot(detail::RcuDomain& domain, Args_&&... args)
+      : domain(domain)
+      , current(new T_(std::forward<Args_>(args)...))
+    { }
+
+    ConcurrentSnapshot(const ConcurrentSnapshot&) = delete;
+    ConcurrentSnapshot& operator = (const ConcurrentSnapshot&) = delete;
+
+    // no reader may be holding the current version anymore, older ones belong to the domain
+    virtual ~ConcurrentSnapshot()
+    { delete this->current.load(std::memory_order_relaxed); }
+
+    // the calling thread must be online in the domain
+    inline const T_& read() const
+    { return *this->current.load(std::memory_order_acquire); }
+
+    inline void publish(std::unique_ptr<T_> value)
+    {
+        const T_* old;
+
+        {
+            std::lock_guard<std::mutex> lock(this->writer_mutex);
+            old = this->unsafePublish(value.release());
+        }
+
+        this->domain.retire(old);
+    }
+
+    template <class... Args_>
+    inline void assign(Args_&&... args)
+    { this->publish(std::unique_ptr<T_>(new T_(std::forward<Args_>(args)...))); }
+
+    // copies the current version, lets the function change the copy and publishes it,
+    // writers can't lose each other's updates
+    template <class Function_>
+    inline void update(Function_ function)
+    {
+        const T_* old;
+
+        {
+            std::lock_guard<std::mutex> lock(this->writer_mutex);
+
+            std::unique_ptr<T_> value(new T_(*this->current.load(std::memory_order_relaxed)));
+            function(*value);
+            old = this->unsafePublish(value.release());
+        }
+
+        this->domain.retire(old);
+    }
+
+    inline detail::RcuDomain& getDomain() const
+    { return this->domain; }
+};
+
+} // end namespace ride
@@ -0,0 +1,331 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
+
+namespace ride {
+
+// a bounded ring for exactly one producer thread and one consumer thread
+//
+// each side owns its index and keeps a cached copy of the other one on its own
+// cache line, so the shared indices are only read when the cached copy runs out
+// the range operations publish a whole batch with a single store and wake up
+//
+// the blocking operations park on event counts, a waiting side costs the other
+// one a fence per publish, the try operations never wait
+template <class T_, std::size_t Capacity_>
+class ConcurrentSpscQueue
+{
+    static_assert(Capacity_ > 0 && (Capacity_ & (Capacity_ - 1)) == 0, "the capacity must be a power of two");
+
+    static constexpr std::size_t mask = Capacity_ - 1;
+
+    typedef typename std::aligned_storage<sizeof(T_), alignof(T_)>::type Storage;
+
+    // indices only ever grow, the slot is the index masked by the capacity
+    //
+    // aligned rather than just padded, so neither side shares a line with whatever
+    // comes before the queue, a queue on the heap only gets that from C++17 on
+    struct alignas(detail::cacheLineSize) ProducerSide
+    {
+        std::atomic_size_t tail;
+        std::size_t cached_head;
+    };
+
+    struct alignas(detail::cacheLineSize) ConsumerSide
+    {
+        std::atomic_size_t head;
+        std::size_t cached_tail;
+    };
+
+    ProducerSide producer;
+    ConsumerSide consumer;
+    Storage slots[Capacity_];
+    detail::EventCount not_empty;
+    detail::EventCount not_full;
+
+    inline T_& slot(std::size_t index)
+    { return *reinterpret_cast<T_*>(&this->slots[index & mask]); }
+
+    // producer side, how many slots can be written without waiting
+    inline std::size_t room(std::size_t wanted)
+    {
+        std::size_t tail = this->producer.tail.load(std::memory_order_relaxed);
+
+        if (Capacity_ - (tail - this->producer.cached_head) < wanted)
+            this->producer.cached_head = this->consumer.head.load(std::memory_order_acquire);
+
+        return Capacity_ - (tail - this->producer.cached_head);
+    }
+
+    // consumer side, how many elements can be read without waiting
+    inline std::size_t ready(std::size_t wanted)
+    {
+        std::size_t head = this->consumer.head.load(std::memory_order_relaxed);
+
+        if (this->consumer.cached_tail - head < wanted)
+            this->consumer.cached_tail = this->producer.tail.load(std::memory_order_acquire);
+
+        return this->consumer.cached_tail - head;
+    }
+
+    inline void publishTail(std::size_t tail)
+    {
+        this->producer.tail.store(tail, std::memory_order_release);
+        this->not_empty.notifyOne();
+    }
+
+    inline void publishHead(std::size_t head)
+    {
+        this->consumer.head.store(head, std::memory_order_release);
+        this->not_full.notifyOne();
+    }
+
+    template <class... Args_>
+    inline bool tryCreate(Args_&&... args)
+    {
+        if (this->room(1) == 0)
+            return false;
+
+        std::size_t tail = this->producer.tail.load(std::memory_order_relaxed);
+        new (&this->slot(tail)) T_(std::forward<Args_>(args)...);
+
+        this->publishTail(tail + 1);
+        return true;
+    }
+
+    inline bool tryRemove(T_& element)
+    {
+        if (this->ready(1) == 0)
+            return false;
+
+        std::size_t head = this->consumer.head.load(std::memory_order_relaxed);
+        T_& stored = this->slot(head);
+
+        element = std::move(stored);
+        stored.~T_();
+
+        this->publishHead(head + 1);
+        return true;
+    }
+
+    // retries the operation until it succeeds, parking in between, or until the timeout
+    template <class Operation_, class Clock_, class Duration_>
+    static inline bool waitFor(detail::EventCount& event, Operation_ operation, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+        while (!operation())
+        {
+            detail::EventCount::Key key = event.prepareWait();
+
+            if (operation())
+            {
+                event.cancelWait();
+                return true;
+            }
+
+            if (!timeout_time)
+                event.wait(key);
+            else if (!event.waitUntil(key, *timeout_time))
+                return operation();
+        }
+
+        return true;
+    }
+
+    template <class Operation_>
+    static inline void waitFor(detail::EventCount& event, Operation_ operation)
+    { waitFor<Operation_, std::chrono::steady_clock, std::chrono::steady_clock::duration>(event, operation, nullptr); }
+  public:
+    ConcurrentSpscQueue()
+    {
+        this->producer.tail.store(0, std::memory_order_relaxed);
+        this->producer.cached_head = 0;
+        this->consumer.head.store(0, std::memory_order_relaxed);
+        this->consumer.cached_tail = 0;
+    }
+
+    ConcurrentSpscQueue(const ConcurrentSpscQueue&) = delete;
+    ConcurrentSpscQueue& operator = (const ConcurrentSpscQueue&) = delete;
+
+    // no other thread may be using the queue anymore
+    virtual ~ConcurrentSpscQueue()
+    {
+        std::size_t tail = this->producer.tail.load(std::memory_order_relaxed);
+
+        for (std::size_t head = this->consumer.head.load(std::memory_order_relaxed); head != tail; ++head)
+            this->slot(head).~T_();
+    }
+
+    // producer operations
+
+    inline bool tryPush(const T_& element)
+    { return this->tryCreate(element); }
+
+    inline bool tryPush(T_&& element)
+    { return this->tryCreate(std::move(element)); }
+
+    template <class... Args_>
+    inline bool tryEmplace(Args_&&... args)
+    { return this->tryCreate(std::forward<Args_>(args)...); }
+
+    inline void push(const T_& element)
+    { waitFor(this->not_full, [&]() { return this->tryCreate(element); }); }
+
+    // the element is only moved from once there is room for it
+    inline void push(T_&& element)
+    { waitFor(this->not_full, [&]() { return this->tryCreate(std::move(element)); }); }
+
+    template <class... Args_>
+    inline void emplace(Args_&&... args)
+    { waitFor(this->not_full, [&]() { return this->tryCreate(std::forward<Args_>(args)...); }); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPushFor(const T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPushUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPushFor(T_&& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPushUntil(std::move(element), std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPushUntil(const T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return waitFor(this->not_full, [&]() { return this->tryCreate(element); }, &timeout_time); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPushUntil(T_&& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return waitFor(this->not_full, [&]() { return this->tryCreate(std::move(element)); }, &timeout_time); }
+
+    // copies as many elements of the range as fit and publishes them at once, returning how many
+    //
+    // when a copy throws nothing is pushed
+    template <class ForwardIt_>
+    inline std::size_t tryPushN(ForwardIt_ first, ForwardIt_ last)
+    {
+        std::size_t available = this->room(Capacity_);
+        std::size_t tail = this->producer.tail.load(std::memory_order_relaxed);
+        std::size_t pushed = 0;
+
+        try {
+            for (; pushed < available && first != last; ++pushed, ++first)
+                new (&this->slot(tail + pushed)) T_(*first);
+        } catch (...) {
+            // nothing was published, the consumer never saw these
+            while (pushed)
+                this->slot(tail + --pushed).~T_();
+            throw;
+        }
+
+        if (pushed)
+            this->publishTail(tail + pushed);
+        return pushed;
+    }
+
+    // waits for room until the whole range is pushed
+    template <class ForwardIt_>
+    inline void pushN(ForwardIt_ first, ForwardIt_ last)
+    {
+        while (first != last)
+        {
+            std::size_t pushed = 0;
+            waitFor(this->not_full, [&]() { return (pushed = this->tryPushN(first, last)) != 0; });
+            std::advance(first, pushed);
+        }
+    }
+
+    // consumer operations
+
+    inline bool tryPop(T_& element)
+    { return this->tryRemove(element); }
+
+    inline bool tryPop(T_&& element)
+    { return this->tryRemove(element); }
+
+    inline void pop(T_& element)
+    { waitFor(this->not_empty, [&]() { return this->tryRemove(element); }); }
+
+    inline void pop(T_&& element)
+    { this->pop(element); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPopFor(T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPopUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPopUntil(T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return waitFor(this->not_empty, [&]() { return this->tryRemove(element); }, &timeout_time); }
+
+    // moves up to max ready elements to out and frees their slots at once, returning how many
+    //
+    // when an assignment to out throws the elements moved before it are still popped
+    template <class OutputIt_>
+    inline std::size_t tryPopN(OutputIt_ out, std::size_t max)
+    {
+        std::size_t available = this->ready(max);
+        std::size_t head = this->consumer.head.load(std::memory_order_relaxed);
+        std::size_t popped = 0;
+
+        try {
+            for (; popped < available && popped < max; ++popped)
+            {
+                T_& stored = this->slot(head + popped);
+
+                *out++ = std::move(stored);
+                stored.~T_();
+            }
+        } catch (...) {
+            // the ones already taken are gone, the one that threw stays queued
+            if (popped)
+                this->publishHead(head + popped);
+            throw;
+        }
+
+        if (popped)
+            this->publishHead(head + popped);
+        return popped;
+    }
+
+    // waits for at least one element, then takes as many as are ready
+    template <class OutputIt_>
+    inline std::size_t popN(OutputIt_ out, std::size_t max)
+    {
+        std::size_t popped = 0;
+
+        if (max)
+            waitFor(this->not_empty, [&]() { return (popped = this->tryPopN(out, max)) != 0; });
+        return popped;
+    }
+
+    // either side, only a snapshot
+
+    inline std::size_t size() const
+    {
+        // the head first, the tail can only have moved further since
+        std::size_t head = this->consumer.head.load(std::memory_order_acquire);
+        return this->producer.tail.load(std::memory_order_acquire) - head;
+    }
+
+    inline bool isEmpty() const
+    { return this->size() == 0; }
+
+    inline bool isFull() const
+    { return this->size() >= Capacity_; }
+
+    static constexpr std::size_t getCapacity()
+    { return Capacity_; }
+};
+
+} // end namespace ride
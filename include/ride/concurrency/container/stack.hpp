@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <deque>
 #include <stack>
 
 #include <ride/concurrency/container/detail/forward_container.hpp>
@@ -14,62 +15,42 @@ namespace ride {
 
 namespace detail {
 
-template <class T_, class Alloc_, class... Args_>
-class Emplacer<std::stack<T_, Alloc_>, Args_...>
-  : AbstractEmplacer<std::stack<T_, Alloc_>>
-  , BasicForwardEmplacer<Args_...>
+template <class T_, class BaseContainer_>
+class ContainerAdapter<std::stack<T_, BaseContainer_>>
 {
+    typedef std::stack<T_, BaseContainer_> Container;
   public:
-    using AbstractEmplacer<std::stack<T_, Alloc_>>::AbstractEmplacer;
+    template <class... Args_>
+    static inline void addFront(Container& container, Args_&&... args)
+    { container.emplace(std::forward<Args_>(args)...); }
 
-    inline void emplaceFront(Args_&&... args) override
+    static inline void removeFront(Container& container, T_& element)
     {
-        this->container.emplace(std::forward<Args_>(args)...);
+        element = container.top();
+        container.pop();
     }
-};
-
-} // end namespace detail
-
-template <class T_, class Alloc_ = std::allocator<T_>>
-class ConcurrentStack
-  : public detail::ForwardConcurrentContainer<T_, std::stack<T_, Alloc_>>
-{
-  private:
-    inline bool unsafeIsEmpty() const override
-    { return this->data.empty(); }
 
-    inline std::size_t unsafeSize() const override
-    { return this->data.size(); }
-
-    inline void unsafeClear() override
+    static inline void removeFront(Container& container, T_&& element)
     {
-        for (std::size_t i = 0; i < this->unsafeSize(); ++i)
-            this->data.pop();
+        element = std::move(container.top());
+        container.pop();
     }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Winconsistent-missing-override"
-    inline void unsafeAddFront(const T_& element)
-    { this->data.push(element); }
-    inline void unsafeAddFront(T_&& element)
-    { this->data.push(std::move(element)); }
-
-    inline void unsafeRemoveFront(T_& element)
+    static inline void clear(Container& container)
     {
-        element = this->data.top();
-        this->data.pop();
+        while (!container.empty())
+            container.pop();
     }
+};
 
-    inline void unsafeRemoveFront(T_&& element)
-    {
-        element = std::move(this->data.top());
-        this->data.pop();
-    }
-#pragma clang diagnostic pop
+} // end namespace detail
+
+template <class T_, class Alloc_ = std::allocator<T_>>
+class ConcurrentStack final
+  : public detail::ForwardConcurrentContainer<T_, std::stack<T_, std::deque<T_, Alloc_>>, ConcurrentStack<T_, Alloc_>>
+{
   public:
-    using detail::ForwardConcurrentContainer<T_, std::deque<T_, Alloc_>>::ForwardConcurrentContainer;
-    virtual ~ConcurrentStack() = default;
+    using detail::ForwardConcurrentContainer<T_, std::stack<T_, std::deque<T_, Alloc_>>, ConcurrentStack<T_, Alloc_>>::ForwardConcurrentContainer;
 };
 
 } // end namespace ride
-
@@ -0,0 +1,210 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
+
+namespace ride {
+
+// the two lock queue of Michael and Scott, producers only take the tail lock
+// and consumers only take the head lock, so they never wait on each other
+//
+// nodes consumers are done with stay allocated and producers take them back,
+// so once the queue has grown to its working size pushing doesn't allocate
+//
+// unbounded, and the size isn't tracked since producers and consumers would share the counter
+template <class T_>
+class ConcurrentTwoLockQueue
+{
+    struct Node
+    {
+        // empty for the dummy node at the head
+        typename std::aligned_storage<sizeof(T_), alignof(T_)>::type storage;
+        std::atomic<Node*> next;
+
+        Node()
+          : next(nullptr)
+        { }
+
+        inline T_& value()
+        { return *reinterpret_cast<T_*>(&this->storage); }
+    };
+
+    typedef std::mutex Mutex;
+    typedef std::lock_guard<Mutex> LockGuard;
+
+    // consumers, the head is always a dummy whose successor is the next element
+    Mutex head_mutex;
+    std::atomic<Node*> head;
+    char head_padding[detail::cacheLineSize];
+
+    // producers
+    Mutex tail_mutex;
+    Node* tail;
+    char tail_padding[detail::cacheLineSize];
+
+    // producers recycling nodes, everything from first up to the head is free
+    Mutex free_mutex;
+    Node* first;
+
+    detail::EventCount not_empty;
+
+    inline Node* acquireNode()
+    {
+        {
+            LockGuard lock(this->free_mutex);
+
+            if (this->first != this->head.load(std::memory_order_acquire))
+            {
+                Node* node = this->first;
+                this->first = node->next.load(std::memory_order_relaxed);
+                node->next.store(nullptr, std::memory_order_relaxed);
+                return node;
+            }
+        }
+
+        return new Node();
+    }
+
+    template <class... Args_>
+    inline void pushNode(Args_&&... args)
+    {
+        Node* node = this->acquireNode();
+
+        try
+        { new (&node->storage) T_(std::forward<Args_>(args)...); }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+
+        {
+            LockGuard lock(this->tail_mutex);
+
+            this->tail->next.store(node, std::memory_order_release);
+            this->tail = node;
+        }
+
+        this->not_empty.notifyOne();
+    }
+
+    inline bool tryPopNode(T_& element)
+    {
+        LockGuard lock(this->head_mutex);
+
+        Node* dummy = this->head.load(std::memory_order_relaxed);
+        Node* node = dummy->next.load(std::memory_order_acquire);
+        if (!node)
+            return false;
+
+        // the node becomes the new dummy, the old one is left for producers to reuse
+        element = std::move(node->value());
+        node->value().~T_();
+
+        this->head.store(node, std::memory_order_release);
+        return true;
+    }
+
+    template <class Clock_, class Duration_>
+    inline bool waitPop(T_& element, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+        while (!this->tryPopNode(element))
+        {
+            detail::EventCount::Key key = this->not_empty.prepareWait();
+
+            if (this->tryPopNode(element))
+            {
+                this->not_empty.cancelWait();
+                return true;
+            }
+
+            if (!timeout_time)
+                this->not_empty.wait(key);
+            else if (!this->not_empty.waitUntil(key, *timeout_time))
+                return this->tryPopNode(element);
+        }
+
+        return true;
+    }
+  public:
+    ConcurrentTwoLockQueue()
+      : head(new Node())
+      , tail(head.load(std::memory_order_relaxed))
+      , first(tail)
+    { }
+
+    ConcurrentTwoLockQueue(const ConcurrentTwoLockQueue&) = delete;
+    ConcurrentTwoLockQueue& operator = (const ConcurrentTwoLockQueue&) = delete;
+
+    // no other thread may be using the queue anymore
+    virtual ~ConcurrentTwoLockQueue()
+    {
+        Node* dummy = this->head.load(std::memory_order_relaxed);
+        Node* node = this->first;
+        // only the nodes after the dummy still hold elements
+        bool holds_element = false;
+
+        while (node)
+        {
+            Node* next = node->next.load(std::memory_order_relaxed);
+
+            if (holds_element)
+                node->value().~T_();
+            else if (node == dummy)
+                holds_element = true;
+
+            delete node;
+            node = next;
+        }
+    }
+
+    inline void push(const T_& element)
+    { this->pushNode(element); }
+
+    inline void push(T_&& element)
+    { this->pushNode(std::move(element)); }
+
+    template <class... Args_>
+    inline void emplace(Args_&&... args)
+    { this->pushNode(std::forward<Args_>(args)...); }
+
+    // waits until an element is pushed
+    inline void pop(T_& element)
+    { this->waitPop<std::chrono::steady_clock, std::chrono::steady_clock::duration>(element, nullptr); }
+
+    inline void pop(T_&& element)
+    { this->pop(element); }
+
+    inline bool tryPop(T_& element)
+    { return this->tryPopNode(element); }
+
+    inline bool tryPop(T_&& element)
+    { return this->tryPopNode(element); }
+
+    template <class Rep_, class Period_>
+    inline bool tryPopFor(T_& element, const std::chrono::duration<Rep_, Period_>& timeout_duration)
+    { return this->tryPopUntil(element, std::chrono::steady_clock::now() + timeout_duration); }
+
+    template <class Clock_, class Duration_>
+    inline bool tryPopUntil(T_& element, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    { return this->waitPop(element, &timeout_time); }
+
+    // only a snapshot, nodes are never freed while the queue lives so this needs no lock
+    inline bool isEmpty() const
+    { return this->head.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) == nullptr; }
+};
+
+} // end namespace ride
@@ -0,0 +1,299 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+
+namespace ride {
+
+// a hash map striped into segments, each an unordered_map behind its own reader writer lock
+//
+// lookups only share the lock of the key's segment, and a segment grows on its own,
+// so a rehash only blocks the keys of that segment while the others stay available
+template <class Key_, class Value_, class Hash_ = std::hash<Key_>, class KeyEqual_ = std::equal_to<Key_>,
+          class Alloc_ = std::allocator<std::pair<const Key_, Value_>>>
+class ConcurrentUnorderedMap
+{
+  public:
+    typedef Key_ KeyType;
+    typedef Value_ MappedType;
+  private:
+    typedef std::unordered_map<Key_, Value_, Hash_, KeyEqual_, Alloc_> Map;
+    typedef std::shared_timed_mutex Mutex;
+    typedef std::shared_lock<Mutex> ReadLock;
+    typedef std::lock_guard<Mutex> WriteLock;
+
+    // padded on both sides so neighbouring segments never share a cache line
+    struct Segment
+    {
+        char front_padding[detail::cacheLineSize];
+        mutable Mutex mutex;
+        Map data;
+        // only written with the lock held, read without it to sum up the size
+        std::atomic_size_t count;
+        char back_padding[detail::cacheLineSize];
+
+        Segment()
+          : count(0)
+        { }
+
+        inline void updateCount()
+        { this->count.store(this->data.size(), std::memory_order_relaxed); }
+    };
+
+    std::size_t segment_mask;
+    std::unique_ptr<Segment[]> segments;
+    Hash_ hasher;
+
+    static inline std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t power = 1;
+        while (power < value)
+            power <<= 1;
+        return power;
+    }
+
+    // mixes the hash so that identity hashes of small integers still spread over the segments
+    inline Segment& segmentFor(const Key_& key) const
+    {
+        std::uint64_t hash = this->hasher(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+
+        return this->segments[static_cast<std::size_t>(hash) & this->segment_mask];
+    }
+
+    template <class Function_>
+    inline void forEachSegment(Function_ function) const
+    {
+        for (std::size_t i = 0; i <= this->segment_mask; ++i)
+            function(this->segments[i]);
+    }
+  public:
+    // the number of segments is rounded up to a power of two
+    explicit ConcurrentUnorderedMap(std::size_t num_segments = 4 * std::max(std::thread::hardware_concurrency(), 1u),
+                                    const Hash_& hasher = Hash_())
+      : segment_mask(roundUpToPowerOfTwo(std::max<std::size_t>(num_segments, 1)) - 1)
+      , segments(new Segment[this->segment_mask + 1])
+      , hasher(hasher)
+    { }
+
+    ConcurrentUnorderedMap(const ConcurrentUnorderedMap&) = delete;
+    ConcurrentUnorderedMap& operator = (const ConcurrentUnorderedMap&) = delete;
+    virtual ~ConcurrentUnorderedMap() = default;
+
+    // returns false if the key was already present, leaving its value alone
+    template <class... Args_>
+    inline bool insert(const Key_& key, Args_&&... args)
+    {
+        Segment& segment = this->segmentFor(key);
+        WriteLock lock(segment.mutex);
+
+        if (!segment.data.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                                  std::forward_as_tuple(std::forward<Args_>(args)...)).second)
+            return false;
+
+        segment.updateCount();
+        return true;
+    }
+
+    // returns true if the key was inserted rather than assigned
+    template <class V_>
+    inline bool insertOrAssign(const Key_& key, V_&& value)
+    {
+        Segment& segment = this->segmentFor(key);
+        WriteLock lock(segment.mutex);
+
+        auto found = segment.data.find(key);
+        if (found != segment.data.end())
+        {
+            found->second = std::forward<V_>(value);
+            return false;
+        }
+
+        segment.data.emplace(key, std::forward<V_>(value));
+        segment.updateCount();
+        return true;
+    }
+
+    // copies the value out, since it may change as soon as the segment is unlocked
+    inline bool find(const Key_& key, Value_& value) const
+    {
+        Segment& segment = this->segmentFor(key);
+        ReadLock lock(segment.mutex);
+
+        auto found = segment.data.find(key);
+        if (found == segment.data.end())
+            return false;
+
+        value = found->second;
+        return true;
+    }
+
+    inline bool contains(const Key_& key) const
+    {
+        Segment& segment = this->segmentFor(key);
+        ReadLock lock(segment.mutex);
+
+        return segment.data.find(key) != segment.data.end();
+    }
+
+    // reads the value in place while the segment is shared, returns false if it is missing
+    template <class Function_>
+    inline bool visit(const Key_& key, Function_ function) const
+    {
+        Segment& segment = this->segmentFor(key);
+        ReadLock lock(segment.mutex);
+
+        auto found = segment.data.find(key);
+        if (found == segment.data.end())
+            return false;
+
+        function(static_cast<const Value_&>(found->second));
+        return true;
+    }
+
+    inline bool erase(const Key_& key)
+    {
+        Segment& segment = this->segmentFor(key);
+        WriteLock lock(segment.mutex);
+
+        if (segment.data.erase(key) == 0)
+            return false;
+
+        segment.updateCount();
+        return true;
+    }
+
+    // atomically updates the entry, a missing value is default constructed first
+    // the function takes the value and returns whether the entry should be kept
+    template <class Function_>
+    inline void compute(const Key_& key, Function_ function)
+    {
+        Segment& segment = this->segmentFor(key);
+        WriteLock lock(segment.mutex);
+
+        auto found = segment.data.find(key);
+        bool inserted = false;
+
+        if (found == segment.data.end())
+        {
+            found = segment.data.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first;
+            inserted = true;
+        }
+
+        bool keep;
+        try
+        { keep = function(found->second); }
+        catch (...)
+        {
+            // don't leave the default value behind if the function never filled it in
+            if (inserted)
+                segment.data.erase(found);
+            throw;
+        }
+
+        if (!keep)
+            segment.data.erase(found);
+
+        segment.updateCount();
+    }
+
+    // returns a copy of the value, creating it with the factory if the key is missing
+    template <class Factory_>
+    inline Value_ computeIfAbsent(const Key_& key, Factory_ factory)
+    {
+        Segment& segment = this->segmentFor(key);
+
+        {
+            ReadLock lock(segment.mutex);
+
+            auto found = segment.data.find(key);
+            if (found != segment.data.end())
+                return found->second;
+        }
+
+        WriteLock lock(segment.mutex);
+
+        // another thread may have created it between the two locks
+        auto found = segment.data.find(key);
+        if (found == segment.data.end())
+        {
+            found = segment.data.emplace(key, factory()).first;
+            segment.updateCount();
+        }
+
+        return found->second;
+    }
+
+    // calls the function on every entry, one segment at a time, so it isn't a snapshot
+    template <class Function_>
+    inline void forEach(Function_ function) const
+    {
+        this->forEachSegment([&function](Segment& segment)
+        {
+            ReadLock lock(segment.mutex);
+
+            for (const auto& entry : segment.data)
+                function(entry.first, entry.second);
+        });
+    }
+
+    inline void clear()
+    {
+        this->forEachSegment([](Segment& segment)
+        {
+            WriteLock lock(segment.mutex);
+
+            segment.data.clear();
+            segment.updateCount();
+        });
+    }
+
+    // spreads the reservation over the segments, each rehashing on its own
+    inline void reserve(std::size_t size)
+    {
+        std::size_t per_segment = size / (this->segment_mask + 1) + 1;
+
+        this->forEachSegment([per_segment](Segment& segment)
+        {
+            WriteLock lock(segment.mutex);
+            segment.data.reserve(per_segment);
+        });
+    }
+
+    // the sum of the segments, which may have changed by the time it returns
+    inline std::size_t size() const
+    {
+        std::size_t total = 0;
+
+        this->forEachSegment([&total](Segment& segment)
+        { total += segment.count.load(std::memory_order_relaxed); });
+        return total;
+    }
+
+    inline bool isEmpty() const
+    { return this->size() == 0; }
+
+    inline std::size_t numSegments() const
+    { return this->segment_mask + 1; }
+};
+
+} // end namespace ride
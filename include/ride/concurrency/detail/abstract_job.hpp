@@ -10,15 +10,48 @@ namespace ride { namespace detail {
 
 class PoolWorkerKey;
 
+class ThreadPool;
+
 class AbstractJob
 {
+    friend class ThreadPool;
+  protected:
+    // internal jobs are scheduled by the library itself, which relies on them running,
+    // so they are never dropped or cleared
+    enum class Kind { Work, Poison, Sync, Internal };
+  private:
+    // fixed at construction, so telling pills apart doesn't need a virtual call per job
+    Kind kind;
+    // the pool's wait epoch the job was submitted in, see ThreadPool::wait
+    unsigned char epoch;
+  protected:
+    AbstractJob(Kind kind = Kind::Work)
+      : kind(kind)
+      , epoch(0)
+    { }
   public:
-    AbstractJob() = default;
     virtual ~AbstractJob() = default;
 
     virtual void operator()(const PoolWorkerKey&) = 0;
-    virtual bool isPoison() const = 0;
-    virtual bool isSync() const = 0;
+
+    inline bool isPoisonPill() const
+    { return this->kind == Kind::Poison; }
+
+    inline bool isSyncPill() const
+    { return this->kind == Kind::Sync; }
+
+    // the pool only reads the kind passed to the constructor now, so overriding
+    // these doesn't change how it treats a job anymore
+    [[deprecated("pass the kind to AbstractJob's constructor, use isPoisonPill")]]
+    inline virtual bool isPoison() const
+    { return this->isPoisonPill(); }
+
+    [[deprecated("pass the kind to AbstractJob's constructor, use isSyncPill")]]
+    inline virtual bool isSync() const
+    { return this->isSyncPill(); }
+
+    inline bool isInternal() const
+    { return this->kind == Kind::Internal; }
 };
 
 } // end namespace detail
@@ -53,12 +53,6 @@ class ActionJob
 
     inline std::future<ResultType> getFuture()
     { return promise.get_future(); }
-
-    inline bool isPoison() const final override
-    { return false; }
-
-    inline bool isSync() const final override
-    { return false; }
 };
 
 } // end namespace detail
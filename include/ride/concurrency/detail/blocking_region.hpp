@@ -0,0 +1,36 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <ride/concurrency/detail/pass_keys.hpp>
+
+namespace ride { namespace detail {
+
+class ThreadPool;
+
+// marks the current worker as blocked for the lifetime of the region
+// the pool may add a compensating worker, which is retired once the region ends
+class BlockingRegion
+{
+    BlockingRegionKey key;
+    ThreadPool& pool;
+    bool compensated;
+  public:
+    BlockingRegion() = delete;
+    BlockingRegion(const BlockingRegion&) = delete;
+    BlockingRegion& operator = (const BlockingRegion&) = delete;
+
+    explicit BlockingRegion(ThreadPool& pool);
+    virtual ~BlockingRegion();
+
+    inline bool isCompensated() const
+    { return this->compensated; }
+};
+
+} // end namespace detail
+
+} // end namespace ride
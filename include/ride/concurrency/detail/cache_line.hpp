@@ -0,0 +1,19 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+
+namespace ride { namespace detail {
+
+// the line size assumed wherever data written by different threads is kept apart,
+// std::hardware_destructive_interference_size is only there from C++17 on
+constexpr std::size_t cacheLineSize = 64;
+
+} // end namespace detail
+
+} // end namespace ride
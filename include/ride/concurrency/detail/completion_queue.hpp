@@ -0,0 +1,96 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <ride/concurrency/detail/event_notifier.hpp>
+
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <ride/concurrency/detail/pool.hpp>
+
+namespace ride { namespace detail {
+
+// results posted by pool jobs for an epoll loop, which waits on getFd and takes
+// everything posted so far with a single drain
+//
+// a drain swaps the posted results out, so it costs the same for one or a thousand
+// of them and passing a vector back in reuses its storage for the next batch
+template <class T_>
+class CompletionQueue
+{
+    typedef std::mutex Mutex;
+    typedef std::lock_guard<Mutex> LockGuard;
+
+    Mutex mutex;
+    std::vector<T_> posted;
+    EventNotifier notifier;
+  public:
+    CompletionQueue() = default;
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator = (const CompletionQueue&) = delete;
+
+    // readable once something was posted, register it with epoll for EPOLLIN
+    inline int getFd() const
+    { return this->notifier.getFd(); }
+
+    template <class... Args_>
+    inline void post(Args_&&... args)
+    {
+        LockGuard lock(this->mutex);
+
+        this->posted.emplace_back(std::forward<Args_>(args)...);
+        this->notifier.signal();
+    }
+
+    // runs the function as a job on the pool and posts what it returns, the future
+    // only reports whether it threw
+    template <class Func_>
+    inline std::future<void> postFrom(ThreadPool& pool, Func_ function)
+    {
+        return pool.emplaceJob(std::function<void()>([this, function]() mutable {
+            this->post(function());
+        }));
+    }
+
+    // everything posted since the last drain, the order they were posted in
+    //
+    // what results held is dropped and its storage takes the next batch
+    inline void drain(std::vector<T_>& results)
+    {
+        this->notifier.acknowledge();
+
+        results.clear();
+
+        LockGuard lock(this->mutex);
+        this->posted.swap(results);
+    }
+
+    inline std::vector<T_> drain()
+    {
+        std::vector<T_> results;
+        this->drain(results);
+        return results;
+    }
+
+    inline bool isEmpty()
+    {
+        LockGuard lock(this->mutex);
+        return this->posted.empty();
+    }
+};
+
+} // end namespace detail
+
+} // end namespace ride
+
+#endif
@@ -0,0 +1,165 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace ride { namespace detail {
+
+// lets threads sleep until a condition they check themselves becomes true
+// notifying is a single load while nobody is waiting
+//
+//  waiter:                                 notifier:
+//    while (!condition) {                    make condition true
+//        Key key = ec.prepareWait();         ec.notifyAll();
+//        if (condition) { ec.cancelWait(); break; }
+//        ec.wait(key);
+//    }
+class EventCount
+{
+  public:
+    typedef std::uint32_t Key;
+  private:
+    std::atomic<std::uint32_t> epoch;
+    std::atomic<std::uint32_t> waiters;
+#if !defined(__linux__)
+    std::mutex mutex;
+    std::condition_variable cond;
+#endif
+
+#if defined(__linux__)
+    inline long futex(int op, std::uint32_t value, const struct timespec* timeout)
+    { return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&this->epoch), op, value, timeout, nullptr, 0); }
+#endif
+
+    // returns false once the timeout has passed
+    template <class Clock_, class Duration_>
+    inline bool park(Key key, const std::chrono::time_point<Clock_, Duration_>* timeout_time)
+    {
+#if defined(__linux__)
+        if (!timeout_time)
+        {
+            this->futex(FUTEX_WAIT_PRIVATE, key, nullptr);
+            return true;
+        }
+
+        auto remaining = *timeout_time - Clock_::now();
+        if (remaining <= remaining.zero())
+            return false;
+
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - seconds);
+
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<std::time_t>(seconds.count());
+        timeout.tv_nsec = static_cast<long>(nanoseconds.count());
+
+        this->futex(FUTEX_WAIT_PRIVATE, key, &timeout);
+        return true;
+#else
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        while (this->epoch.load(std::memory_order_acquire) == key)
+        {
+            if (!timeout_time)
+                this->cond.wait(lock);
+            else if (this->cond.wait_until(lock, *timeout_time) == std::cv_status::timeout)
+                return false;
+        }
+
+        return true;
+#endif
+    }
+
+    inline void notify(int count)
+    {
+        // orders the caller's condition change before checking for waiters
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (this->waiters.load(std::memory_order_seq_cst) == 0)
+            return;
+
+        this->epoch.fetch_add(1, std::memory_order_seq_cst);
+
+#if defined(__linux__)
+        this->futex(FUTEX_WAKE_PRIVATE, static_cast<std::uint32_t>(count), nullptr);
+#else
+        { std::lock_guard<std::mutex> lock(this->mutex); }
+
+        if (count == 1)
+            this->cond.notify_one();
+        else
+            this->cond.notify_all();
+#endif
+    }
+  public:
+    EventCount()
+      : epoch(0)
+      , waiters(0)
+    { }
+
+    EventCount(const EventCount&) = delete;
+    EventCount& operator = (const EventCount&) = delete;
+    virtual ~EventCount() = default;
+
+    inline Key prepareWait()
+    {
+        this->waiters.fetch_add(1, std::memory_order_seq_cst);
+        return this->epoch.load(std::memory_order_seq_cst);
+    }
+
+    inline void cancelWait()
+    { this->waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+    inline void wait(Key key)
+    {
+        while (this->epoch.load(std::memory_order_acquire) == key)
+            this->park<std::chrono::steady_clock, std::chrono::steady_clock::duration>(key, nullptr);
+
+        this->cancelWait();
+    }
+
+    // returns false if the timeout passed before a notification
+    template <class Clock_, class Duration_>
+    inline bool waitUntil(Key key, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
+    {
+        while (this->epoch.load(std::memory_order_acquire) == key)
+        {
+            if (!this->park(key, &timeout_time))
+            {
+                this->cancelWait();
+                return this->epoch.load(std::memory_order_acquire) != key;
+            }
+        }
+
+        this->cancelWait();
+        return true;
+    }
+
+    inline void notifyOne()
+    { this->notify(1); }
+
+    inline void notifyAll()
+    { this->notify(INT_MAX); }
+};
+
+} // end namespace detail
+
+} // end namespace ride
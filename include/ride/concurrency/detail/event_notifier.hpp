@@ -0,0 +1,81 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#if defined(__linux__)
+#define RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+#endif
+
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ride { namespace detail {
+
+// an eventfd that becomes readable when something is ready, for an epoll loop to
+// pick up work without a thread blocking on it
+//
+// signals coalesce, only the first one after the consumer acknowledged reaches the
+// fd, so a busy producer costs one write per drain instead of one per element
+class EventNotifier
+{
+    int event_fd;
+    // set by the first signal, cleared by acknowledge
+    std::atomic_bool signalled;
+  public:
+    EventNotifier()
+      : event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+      , signalled(false)
+    {
+        if (this->event_fd < 0)
+            throw std::system_error(errno, std::system_category(), "eventfd");
+    }
+
+    EventNotifier(const EventNotifier&) = delete;
+    EventNotifier& operator = (const EventNotifier&) = delete;
+
+    ~EventNotifier()
+    { ::close(this->event_fd); }
+
+    // register it with epoll for EPOLLIN
+    inline int getFd() const
+    { return this->event_fd; }
+
+    // call with the lock held the consumer drains under, which orders a signal after
+    // an acknowledge with the drain that follows it
+    inline void signal()
+    {
+        // the plain load keeps the common already signalled case free of a locked instruction
+        if (this->signalled.load(std::memory_order_relaxed) || this->signalled.exchange(true))
+            return;
+
+        std::uint64_t one = 1;
+        while (::write(this->event_fd, &one, sizeof(one)) < 0 && errno == EINTR) { }
+    }
+
+    // call once the fd is readable and before draining, so whatever is added while
+    // draining signals again instead of being left behind
+    inline void acknowledge()
+    {
+        std::uint64_t value;
+        while (::read(this->event_fd, &value, sizeof(value)) < 0 && errno == EINTR) { }
+
+        this->signalled.store(false);
+    }
+};
+
+} // end namespace detail
+
+} // end namespace ride
+
+#endif
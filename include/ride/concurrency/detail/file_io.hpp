@@ -0,0 +1,380 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#if defined(__linux__)
+#define RIDE_CONCURRENCY_HAS_FILE_IO
+#endif
+
+#ifdef RIDE_CONCURRENCY_HAS_FILE_IO
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ride/concurrency/detail/abstract_job.hpp>
+#include <ride/concurrency/detail/pool.hpp>
+
+namespace ride { namespace detail {
+
+enum class FileIOBackend
+{
+    // io_uring when the kernel has it, the thread otherwise
+    Automatic,
+    // one io_uring instance, completions are reaped by the reactor thread
+    Ring,
+    // a few reactor threads do the reads and writes themselves
+    Thread
+};
+
+// memory handed to the kernel once, so reads and writes through it skip mapping
+// the pages on every operation
+struct FileBuffer
+{
+    void* data;
+    std::size_t size;
+};
+
+enum class FileOpKind { Read, Write, ReadFixed, WriteFixed };
+
+// an operation waiting for the reactor, and once it completed the job delivering
+// its result on the pool
+class FileOp
+  : public AbstractJob
+{
+  public:
+    FileOpKind kind;
+    int fd;
+    char* buffer;
+    std::size_t length;
+    std::uint64_t offset;
+    // where in the registered buffer, for the fixed operations
+    std::size_t buffer_index, buffer_offset;
+    // the bytes transferred, or a negated errno
+    std::int64_t result;
+
+    FileOp(FileOpKind kind, int fd, char* buffer, std::size_t length, std::uint64_t offset)
+      : kind(kind)
+      , fd(fd)
+      , buffer(buffer)
+      , length(length)
+      , offset(offset)
+      , buffer_index(0)
+      , buffer_offset(0)
+      , result(0)
+    { }
+
+    inline bool isFixed() const
+    { return this->kind == FileOpKind::ReadFixed || this->kind == FileOpKind::WriteFixed; }
+
+    // fails the future right away, for an operation that can't reach the pool anymore
+    virtual void abandon(int error) = 0;
+};
+
+template <class Ret_, class Func_>
+class FileOpJob final
+  : public FileOp
+{
+    std::promise<Ret_> promise;
+    Func_ handler;
+
+    template <class R_>
+    static inline void fulfill(std::promise<R_>& promise, Func_& handler, std::size_t transferred)
+    { promise.set_value(handler(transferred)); }
+
+    static inline void fulfill(std::promise<void>& promise, Func_& handler, std::size_t transferred)
+    {
+        handler(transferred);
+        promise.set_value();
+    }
+  public:
+    FileOpJob(FileOpKind kind, int fd, char* buffer, std::size_t length, std::uint64_t offset, Func_ handler)
+      : FileOp(kind, fd, buffer, length, offset)
+      , handler(std::move(handler))
+    { }
+
+    inline std::future<Ret_> getFuture()
+    { return this->promise.get_future(); }
+
+    // a failed operation never reaches the handler, the future gets the error instead
+    inline void operator()(const PoolWorkerKey&) override
+    {
+        try {
+            if (this->result < 0)
+                throw std::system_error(static_cast<int>(-this->result), std::system_category());
+
+            fulfill(this->promise, this->handler, static_cast<std::size_t>(this->result));
+        } catch (...) {
+            this->promise.set_exception(std::current_exception());
+        }
+    }
+
+    inline void abandon(int error) override
+    { this->promise.set_exception(std::make_exception_ptr(std::system_error(error, std::system_category()))); }
+};
+
+// the handler of the operations without one, the future gets the bytes transferred
+class TransferredBytes
+{
+  public:
+    inline std::size_t operator()(std::size_t transferred) const
+    { return transferred; }
+};
+
+template <class Func_>
+using FileOpResult = typename std::result_of<Func_&(std::size_t)>::type;
+
+template <class Func_>
+inline std::unique_ptr<FileOp> makeFileOp(FileOpKind kind, int fd, char* buffer, std::size_t length, std::uint64_t offset,
+    Func_ handler, std::future<FileOpResult<Func_>>& future)
+{
+    FileOpJob<FileOpResult<Func_>, Func_>* op =
+        new FileOpJob<FileOpResult<Func_>, Func_>(kind, fd, buffer, length, offset, std::move(handler));
+    future = op->getFuture();
+    return std::unique_ptr<FileOp>(op);
+}
+
+template <class Func_>
+inline std::unique_ptr<FileOp> makeFixedFileOp(FileOpKind kind, int fd, std::size_t buffer_index, std::size_t buffer_offset,
+    std::size_t length, std::uint64_t offset, Func_ handler, std::future<FileOpResult<Func_>>& future)
+{
+    // the buffer is looked up once the operation is submitted
+    std::unique_ptr<FileOp> op = makeFileOp(kind, fd, nullptr, length, offset, std::move(handler), future);
+    op->buffer_index = buffer_index;
+    op->buffer_offset = buffer_offset;
+    return op;
+}
+
+// operations collected to reach the kernel together, one wakeup of the reactor
+// and one submission for all of them
+class FileBatch
+{
+    friend class FileIO;
+
+    std::vector<std::unique_ptr<FileOp>> ops;
+  public:
+    FileBatch() = default;
+    FileBatch(const FileBatch&) = delete;
+    FileBatch& operator = (const FileBatch&) = delete;
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> read(int fd, void* buffer, std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->ops.push_back(makeFileOp(FileOpKind::Read, fd, static_cast<char*>(buffer), length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> read(int fd, void* buffer, std::size_t length, std::uint64_t offset)
+    { return this->read(fd, buffer, length, offset, TransferredBytes()); }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> write(int fd, const void* buffer, std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        // only ever read from
+        char* data = static_cast<char*>(const_cast<void*>(buffer));
+        this->ops.push_back(makeFileOp(FileOpKind::Write, fd, data, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> write(int fd, const void* buffer, std::size_t length, std::uint64_t offset)
+    { return this->write(fd, buffer, length, offset, TransferredBytes()); }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> readFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset,
+        std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->ops.push_back(makeFixedFileOp(FileOpKind::ReadFixed, fd, buffer_index, buffer_offset, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> readFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset, std::size_t length, std::uint64_t offset)
+    { return this->readFixed(fd, buffer_index, buffer_offset, length, offset, TransferredBytes()); }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> writeFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset,
+        std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->ops.push_back(makeFixedFileOp(FileOpKind::WriteFixed, fd, buffer_index, buffer_offset, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> writeFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset, std::size_t length, std::uint64_t offset)
+    { return this->writeFixed(fd, buffer_index, buffer_offset, length, offset, TransferredBytes()); }
+
+    inline std::size_t size() const
+    { return this->ops.size(); }
+
+    inline bool empty() const
+    { return this->ops.empty(); }
+};
+
+// positioned reads and writes on files without tying up a worker while they wait
+//
+// a single reactor thread owns an io_uring instance, or when the kernel has none
+// a few reactor threads do the operations themselves, and every completion is delivered as a job on the
+// pool that runs the operation's handler and makes its future ready, so the future
+// can be waited on with the pool's waitFor from inside a job
+//
+// like pread and pwrite an operation may transfer less than asked for, a failed one
+// makes the future throw a std::system_error and skips the handler
+//
+// when the reactor fails, every operation it still had and every one submitted after
+// that fails with the reactor's error, it doesn't recover, though the ones already
+// in the kernel only fail once the kernel is done with their buffers
+//
+// destroying it waits until every submitted operation was delivered to the pool
+class FileIO
+{
+    typedef std::mutex Mutex;
+    typedef std::unique_lock<Mutex> Lock;
+    typedef std::lock_guard<Mutex> LockGuard;
+    typedef std::unique_ptr<FileOp> PolymorphicOp;
+
+    class Ring;
+
+    std::shared_ptr<ThreadPool> pool;
+    std::unique_ptr<Ring> ring;
+    std::vector<FileBuffer> buffers;
+
+    Mutex mutex;
+    std::condition_variable wakeup;
+    // handed over to the reactor, the ring takes all of them at once and
+    // the threads one at a time
+    std::deque<PolymorphicOp> pending;
+    bool stopping;
+    // the errno the reactor failed with, zero while it runs
+    int failure;
+
+    // without a ring, how many threads do the reads and writes at most
+    static constexpr unsigned maxThreads = 4;
+
+    std::vector<std::thread> reactors;
+
+    // resolves the registered buffer of a fixed operation, throws when it doesn't fit
+    void prepare(FileOp& op) const;
+
+    void enqueue(std::vector<PolymorphicOp>& ops);
+
+    // the error of the failed reactor, nothing gets past it anymore
+    void fail(std::vector<PolymorphicOp>& ops, int error);
+    // waits until the kernel completed every operation the ring handed it, moving them to ops
+    void drainRing(std::vector<PolymorphicOp>& ops);
+
+    void enqueue(PolymorphicOp&& op);
+
+    // like strands, the capacity is no reason to hold back a completion
+    void deliver(PolymorphicOp&& op);
+
+    void runRing();
+
+    void runThread();
+
+    // moves the pending operations over, returns true once the reactor is stopping
+    bool collect(std::vector<PolymorphicOp>& ops);
+
+    // waits for the next operation for a reactor thread, false once it has to stop
+    bool take(PolymorphicOp& op);
+
+    // everyone is for more than one operation or for stopping
+    void wake(bool everyone);
+  public:
+    // up to queue_depth operations are in the kernel at once, the rest wait in the reactor,
+    // without a ring that many threads up to maxThreads do them side by side
+    //
+    // the buffers are registered before the reactor starts, they have to outlive it
+    FileIO(std::shared_ptr<ThreadPool> pool, std::vector<FileBuffer> buffers,
+        unsigned queue_depth = 128, FileIOBackend backend = FileIOBackend::Automatic);
+
+    FileIO(std::shared_ptr<ThreadPool> pool, unsigned queue_depth = 128, FileIOBackend backend = FileIOBackend::Automatic)
+      : FileIO(pool, std::vector<FileBuffer>(), queue_depth, backend)
+    { }
+
+    FileIO(const FileIO&) = delete;
+    FileIO& operator = (const FileIO&) = delete;
+
+    ~FileIO();
+
+    // Ring or Thread, whichever the reactor ended up with
+    FileIOBackend backend() const;
+
+    inline const std::vector<FileBuffer>& getBuffers() const
+    { return this->buffers; }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> read(int fd, void* buffer, std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->enqueue(makeFileOp(FileOpKind::Read, fd, static_cast<char*>(buffer), length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> read(int fd, void* buffer, std::size_t length, std::uint64_t offset)
+    { return this->read(fd, buffer, length, offset, TransferredBytes()); }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> write(int fd, const void* buffer, std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        char* data = static_cast<char*>(const_cast<void*>(buffer));
+        this->enqueue(makeFileOp(FileOpKind::Write, fd, data, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> write(int fd, const void* buffer, std::size_t length, std::uint64_t offset)
+    { return this->write(fd, buffer, length, offset, TransferredBytes()); }
+
+    // reads straight into a registered buffer, the handler finds the data there
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> readFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset,
+        std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->enqueue(makeFixedFileOp(FileOpKind::ReadFixed, fd, buffer_index, buffer_offset, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> readFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset, std::size_t length, std::uint64_t offset)
+    { return this->readFixed(fd, buffer_index, buffer_offset, length, offset, TransferredBytes()); }
+
+    template <class Func_>
+    inline std::future<FileOpResult<Func_>> writeFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset,
+        std::size_t length, std::uint64_t offset, Func_ handler)
+    {
+        std::future<FileOpResult<Func_>> future;
+        this->enqueue(makeFixedFileOp(FileOpKind::WriteFixed, fd, buffer_index, buffer_offset, length, offset, std::move(handler), future));
+        return future;
+    }
+
+    inline std::future<std::size_t> writeFixed(int fd, std::size_t buffer_index, std::size_t buffer_offset, std::size_t length, std::uint64_t offset)
+    { return this->writeFixed(fd, buffer_index, buffer_offset, length, offset, TransferredBytes()); }
+
+    // submits every operation of the batch together and leaves it empty, nothing is
+    // submitted when one of them doesn't fit its registered buffer
+    inline void submit(FileBatch& batch)
+    { this->enqueue(batch.ops); }
+
+    inline ThreadPool& getPool()
+    { return *this->pool; }
+};
+
+} // end namespace detail
+
+} // end namespace ride
+
+#endif
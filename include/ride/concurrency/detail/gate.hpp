@@ -6,16 +6,33 @@
 
 #pragma once
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
+
+#include <ride/concurrency/detail/event_count.hpp>
 
 namespace ride { namespace detail {
 
+// passing an open gate is a single load, closed gates park on an event count
 class Gate
 {
-    bool closed;
-    std::mutex mutex;
-    std::condition_variable cond;
+    std::atomic_bool closed;
+    EventCount opened;
+
+    inline void park()
+    {
+        while (this->closed.load(std::memory_order_seq_cst))
+        {
+            EventCount::Key key = this->opened.prepareWait();
+
+            if (!this->closed.load(std::memory_order_seq_cst))
+            {
+                this->opened.cancelWait();
+                return;
+            }
+
+            this->opened.wait(key);
+        }
+    }
   public:
     Gate()
       : closed(false)
@@ -27,27 +44,21 @@ class Gate
 
     inline void wait()
     {
-        std::unique_lock<std::mutex> lock(this->mutex);
-
-        while (closed)
-            cond.wait(lock);
-        lock.unlock();
+        if (this->closed.load(std::memory_order_relaxed))
+            this->park();
     }
 
+    inline bool isClosed() const
+    { return this->closed.load(std::memory_order_seq_cst); }
+
     inline void open()
     {
-        std::lock_guard<std::mutex> lock(this->mutex);
-
-        closed = false;
-        cond.notify_all();
+        this->closed.store(false, std::memory_order_seq_cst);
+        this->opened.notifyAll();
     }
 
     inline void close()
-    {
-        std::lock_guard<std::mutex> lock(this->mutex);
-
-        closed = true;
-    }
+    { this->closed.store(true, std::memory_order_seq_cst); }
 };
 
 } // end namespace detail
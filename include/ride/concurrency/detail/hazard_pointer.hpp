@@ -0,0 +1,78 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace ride { namespace detail {
+
+// one published pointer, records are never freed so they can be scanned without locking
+struct HazardRecord
+{
+    std::atomic<const void*> pointer;
+    std::atomic_bool active;
+    // only written before the record is published
+    HazardRecord* next;
+
+    HazardRecord()
+      : pointer(nullptr)
+      , active(true)
+      , next(nullptr)
+    { }
+};
+
+// keeps lock-free structures from deleting a node another thread is still reading
+//
+// a reader protects the node before dereferencing it, a remover retires the node
+// once it is unreachable, and retired nodes are only deleted after no record holds them
+class HazardPointer
+{
+    HazardRecord* record;
+    // the calling thread's reusable record, if this holder took it
+    bool cached;
+  public:
+    HazardPointer();
+    HazardPointer(const HazardPointer&) = delete;
+    HazardPointer& operator = (const HazardPointer&) = delete;
+    virtual ~HazardPointer();
+
+    // returns the current value of source, which stays allocated until cleared
+    template <class T_>
+    inline T_* protect(const std::atomic<T_*>& source)
+    {
+        T_* pointer = source.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            this->record->pointer.store(pointer, std::memory_order_seq_cst);
+
+            T_* current = source.load(std::memory_order_seq_cst);
+            if (current == pointer)
+                return pointer;
+
+            pointer = current;
+        }
+    }
+
+    inline void clear()
+    { this->record->pointer.store(nullptr, std::memory_order_release); }
+
+    // delete the pointer once no hazard pointer protects it
+    static void retire(void* pointer, void (*deleter)(void*));
+
+    template <class T_>
+    static inline void retire(T_* pointer)
+    { retire(pointer, [](void* object) { delete static_cast<T_*>(object); }); }
+
+    // delete every retired pointer that isn't protected, mostly for tests and shutdown
+    static void reclaim();
+};
+
+} // end namespace detail
+
+} // end namespace ride
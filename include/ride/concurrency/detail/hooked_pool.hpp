@@ -0,0 +1,165 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+
+#include <ride/concurrency/detail/pool.hpp>
+#include <ride/concurrency/detail/worker.hpp>
+
+namespace ride { namespace detail {
+
+// a hook policy that does nothing, derive from it and hide the hooks you need,
+// the ones left empty are inlined away
+class NoHooks
+{
+  public:
+    inline void beforeExecute() { }
+    inline void afterExecute() { }
+    inline void onStartup() { }
+    inline void onShutdown() { }
+    inline void onTimeout() { }
+    inline void onSynchronize() { }
+};
+
+// runs the worker's policy and then the pool's, in the order of the virtual hooks
+template <class WorkerHooks_, class PoolHooks_>
+class StaticHooks
+{
+    WorkerHooks_& worker;
+    PoolHooks_& pool;
+  public:
+    StaticHooks(WorkerHooks_& worker, PoolHooks_& pool)
+      : worker(worker)
+      , pool(pool)
+    { }
+
+    inline void beforeExecute()
+    {
+        this->worker.beforeExecute();
+        this->pool.beforeExecute();
+    }
+
+    inline void afterExecute()
+    {
+        this->worker.afterExecute();
+        this->pool.afterExecute();
+    }
+
+    inline void onStartup()
+    {
+        this->worker.onStartup();
+        this->pool.onStartup();
+    }
+
+    inline void onShutdown()
+    {
+        this->worker.onShutdown();
+        this->pool.onShutdown();
+    }
+
+    inline void onTimeout()
+    {
+        this->worker.onTimeout();
+        this->pool.onTimeout();
+    }
+
+    inline void onSynchronize()
+    {
+        this->worker.onSynchronize();
+        this->pool.onSynchronize();
+    }
+};
+
+// a pool whose hooks are a policy type instead of virtual overrides
+//
+// HookedWorkerThreads call the policy directly, any other worker still
+// reaches it through the pool's virtual hooks
+template <class Hooks_>
+class HookedThreadPool
+  : public ThreadPool
+{
+    Hooks_ hook_policy;
+  protected:
+    inline void beforeExecuteJob() override final
+    { this->hook_policy.beforeExecute(); }
+
+    inline void afterExecuteJob() override final
+    { this->hook_policy.afterExecute(); }
+
+    inline void onStartupWorker() override final
+    { this->hook_policy.onStartup(); }
+
+    inline void onShutdownWorker() override final
+    { this->hook_policy.onShutdown(); }
+
+    inline void onTimeoutWorker() override final
+    { this->hook_policy.onTimeout(); }
+
+    inline void onSynchronizeWorker() override final
+    { this->hook_policy.onSynchronize(); }
+  public:
+    typedef Hooks_ Hooks;
+
+    HookedThreadPool() = default;
+
+    HookedThreadPool(const Hooks_& hooks)
+      : hook_policy(hooks)
+    { }
+
+    inline Hooks_& hooks()
+    { return this->hook_policy; }
+};
+
+// a worker running the job loop with both its own and the pool's hooks known at
+// compile time, so a job costs no virtual calls besides its own
+//
+// it must be added to a HookedThreadPool<PoolHooks_>
+template <class Hooks_ = NoHooks, class PoolHooks_ = NoHooks>
+class HookedWorkerThread final
+  : public WorkerThread
+{
+    Hooks_ hook_policy;
+    PoolHooks_& pool_hooks;
+
+    static inline PoolHooks_& poolHooksOf(ThreadPool& owner)
+    {
+        HookedThreadPool<PoolHooks_>* hooked = dynamic_cast<HookedThreadPool<PoolHooks_>*>(&owner);
+
+        if (!hooked)
+            throw std::invalid_argument("the worker's pool has different hooks");
+
+        return hooked->hooks();
+    }
+
+    inline void run() override
+    { this->runWith(StaticHooks<Hooks_, PoolHooks_>(this->hook_policy, this->pool_hooks)); }
+  public:
+    typedef Hooks_ Hooks;
+
+    HookedWorkerThread(std::shared_ptr<ThreadPool> owner)
+      : WorkerThread(owner)
+      , pool_hooks(poolHooksOf(*owner))
+    { }
+
+    HookedWorkerThread(std::shared_ptr<ThreadPool> owner, const Hooks_& hooks)
+      : WorkerThread(owner)
+      , hook_policy(hooks)
+      , pool_hooks(poolHooksOf(*owner))
+    { }
+
+    inline Hooks_& hooks()
+    { return this->hook_policy; }
+  public: // private key APIs
+    inline bool runPendingJob(const HelpWorkerKey&) override
+    { return this->runPendingJobWith(StaticHooks<Hooks_, PoolHooks_>(this->hook_policy, this->pool_hooks)); }
+};
+
+} // end namespace detail
+
+} // end namespace ride
@@ -10,6 +10,13 @@ namespace ride { namespace detail {
 
 class ThreadPool;
 class WorkerThread;
+class Strand;
+class Pipeline;
+class Select;
+class FileIO;
+class BlockingRegion;
+template <class T_>
+class WorkerLocal;
 
 class StartWorkerKey
 {
@@ -22,11 +29,57 @@ class StartWorkerKey
 class PoolWorkerKey
 {
     friend class WorkerThread;
+    // runs rejected jobs on the submitting thread
+    friend class ThreadPool;
 
     PoolWorkerKey() = default;
     virtual ~PoolWorkerKey() = default;
 };
 
+class HelpWorkerKey
+{
+    friend class ThreadPool;
+
+    HelpWorkerKey() = default;
+    virtual ~HelpWorkerKey() = default;
+};
+
+class LocalJobKey
+{
+    friend class ThreadPool;
+
+    LocalJobKey() = default;
+    virtual ~LocalJobKey() = default;
+};
+
+class BlockingRegionKey
+{
+    friend class BlockingRegion;
+
+    BlockingRegionKey() = default;
+    virtual ~BlockingRegionKey() = default;
+};
+
+class ScheduleJobKey
+{
+    friend class Strand;
+    friend class Pipeline;
+    friend class Select;
+    friend class FileIO;
+
+    ScheduleJobKey() = default;
+    virtual ~ScheduleJobKey() = default;
+};
+
+class WorkerLocalKey
+{
+    template <class T_>
+    friend class WorkerLocal;
+
+    WorkerLocalKey() = default;
+    virtual ~WorkerLocalKey() = default;
+};
+
 } // end namespace detail
 
 } // end namespace ride
@@ -0,0 +1,298 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ride/concurrency/detail/pool.hpp>
+
+namespace ride { namespace detail {
+
+enum class StageMode
+{
+    // one item at a time, in the order the source produced them
+    SerialInOrder,
+    // one item at a time, in whatever order they arrive
+    SerialOutOfOrder,
+    // any number of items at once
+    Parallel
+};
+
+// handed to the source, which calls stop once it has nothing left to produce
+class FlowControl
+{
+    bool stopped;
+  public:
+    FlowControl()
+      : stopped(false)
+    { }
+
+    inline void stop()
+    { this->stopped = true; }
+
+    inline bool isStopped() const
+    { return this->stopped; }
+};
+
+// what a stage has done so far, to find the one holding the pipeline back
+struct PipelineStats
+{
+    std::size_t items;
+    // time spent in the stage's function
+    std::chrono::nanoseconds busy;
+    // time items spent queued in front of the stage, serial stages only
+    std::chrono::nanoseconds waited;
+    std::size_t queued;
+    std::size_t max_queued;
+};
+
+// an item between two stages, its type is only known to the stages on either side
+class PipelineItem
+{
+  public:
+    PipelineItem() = default;
+    PipelineItem(const PipelineItem&) = delete;
+    PipelineItem& operator = (const PipelineItem&) = delete;
+    virtual ~PipelineItem() = default;
+};
+
+template <class T_>
+class PipelineValue final
+  : public PipelineItem
+{
+  public:
+    T_ value;
+
+    template <class... Args_>
+    PipelineValue(Args_&&... args)
+      : value(std::forward<Args_>(args)...)
+    { }
+};
+
+struct PipelineToken
+{
+    // the order the source produced it in
+    std::size_t sequence;
+    std::unique_ptr<PipelineItem> item;
+    // a stage threw, the token only passes the remaining stages to keep their order
+    bool failed;
+    std::chrono::steady_clock::time_point queued_at;
+
+    PipelineToken()
+      : sequence(0)
+      , failed(false)
+    { }
+};
+
+class PipelineStage
+{
+    friend class Pipeline;
+
+    typedef std::mutex Mutex;
+    typedef std::lock_guard<Mutex> LockGuard;
+
+    StageMode mode;
+    Mutex mutex;
+    // true while a token is inside a serial stage
+    bool running;
+    std::size_t next_sequence;
+    // tokens waiting for a serial stage, by sequence when in order and by arrival otherwise
+    std::map<std::size_t, PipelineToken> waiting;
+    std::deque<PipelineToken> arrived;
+    std::atomic_size_t items, max_queued;
+    std::atomic<std::int64_t> busy_ns, waited_ns;
+
+    inline std::size_t unsafeQueued() const
+    { return this->waiting.size() + this->arrived.size(); }
+
+    // whether the token may go through a serial stage now, queues it otherwise
+    bool admit(PipelineToken& token);
+
+    // after a token went through a serial stage, hands over the next one that may go
+    bool release(PipelineToken& next);
+
+    void reset();
+
+    PipelineStats stats();
+  protected:
+    // replaces the item with the stage's output, or produces one in the source
+    virtual void process(FlowControl& flow, std::unique_ptr<PipelineItem>& item) = 0;
+  public:
+    PipelineStage(StageMode mode)
+      : mode(mode)
+      , running(false)
+      , next_sequence(0)
+      , items(0)
+      , max_queued(0)
+      , busy_ns(0)
+      , waited_ns(0)
+    { }
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator = (const PipelineStage&) = delete;
+    virtual ~PipelineStage() = default;
+};
+
+template <class Out_, class Func_>
+class SourceStage final
+  : public PipelineStage
+{
+    Func_ func;
+
+    inline void process(FlowControl& flow, std::unique_ptr<PipelineItem>& item) override
+    { item.reset(new PipelineValue<Out_>(this->func(flow))); }
+  public:
+    SourceStage(Func_ func)
+      : PipelineStage(StageMode::SerialInOrder)
+      , func(std::move(func))
+    { }
+};
+
+template <class In_, class Out_, class Func_>
+class TransformStage final
+  : public PipelineStage
+{
+    Func_ func;
+
+    inline void process(FlowControl&, std::unique_ptr<PipelineItem>& item) override
+    { item.reset(new PipelineValue<Out_>(this->func(std::move(static_cast<PipelineValue<In_>&>(*item).value)))); }
+  public:
+    TransformStage(StageMode mode, Func_ func)
+      : PipelineStage(mode)
+      , func(std::move(func))
+    { }
+};
+
+template <class In_, class Func_>
+class SinkStage final
+  : public PipelineStage
+{
+    Func_ func;
+
+    inline void process(FlowControl&, std::unique_ptr<PipelineItem>& item) override
+    {
+        this->func(std::move(static_cast<PipelineValue<In_>&>(*item).value));
+        item.reset();
+    }
+  public:
+    SinkStage(StageMode mode, Func_ func)
+      : PipelineStage(mode)
+      , func(std::move(func))
+    { }
+};
+
+template <class T_>
+class PipelineBuilder;
+
+// a source, any number of transforms and a sink, running as jobs on a pool
+//
+// at most max_tokens items are between the source and the sink at once, so the
+// queues in front of the serial stages are bounded by it and a slow stage holds
+// the source back instead of letting items pile up
+//
+// no stage ever blocks a worker, a token that can't enter a serial stage is queued
+// there and picked up by the job finishing the token ahead of it
+class Pipeline
+{
+    template <class T_>
+    friend class PipelineBuilder;
+
+    class Run;
+    class RunJob;
+
+    std::vector<std::unique_ptr<PipelineStage>> stages;
+
+    Pipeline() = default;
+
+    inline void addStage(std::unique_ptr<PipelineStage> stage)
+    { this->stages.push_back(std::move(stage)); }
+
+    // pipelines bound their own tokens, so like strands they aren't subject to the capacity
+    static void schedule(const std::shared_ptr<Run>& run, PipelineToken&& token, std::size_t stage, bool admitted);
+
+    // runs the stage on the token, a failing stage fails the run and the token
+    static void execute(Run& run, PipelineStage& stage, PipelineToken& token);
+
+    static void produce(const std::shared_ptr<Run>& run);
+
+    // carries the token through the stages from the given one on
+    static void advance(const std::shared_ptr<Run>& run, PipelineToken&& token, std::size_t stage, bool admitted);
+
+    // a token left the sink, making room for the source
+    static void finish(const std::shared_ptr<Run>& run);
+  public:
+    Pipeline(Pipeline&&) = default;
+    Pipeline& operator = (Pipeline&&) = default;
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator = (const Pipeline&) = delete;
+
+    // the source returns an item every call until it stops the flow, whatever
+    // it returns from that call is dropped
+    template <class Func_, class T_ = typename std::decay<decltype(std::declval<Func_&>()(std::declval<FlowControl&>()))>::type>
+    static inline PipelineBuilder<T_> source(Func_ func)
+    {
+        Pipeline pipeline;
+        pipeline.addStage(std::unique_ptr<PipelineStage>(new SourceStage<T_, Func_>(std::move(func))));
+        return PipelineBuilder<T_>(std::move(pipeline));
+    }
+
+    // run until the source stops and every item reached the sink, helping the pool
+    // meanwhile when called from one of its workers
+    //
+    // rethrows the first exception a stage threw, the source stops producing after it
+    void run(std::shared_ptr<ThreadPool> pool, std::size_t max_tokens);
+
+    inline std::size_t numStages() const
+    { return this->stages.size(); }
+
+    // one per stage, the source first, reset by every run
+    std::vector<PipelineStats> stats() const;
+};
+
+template <class T_>
+class PipelineBuilder
+{
+    friend class Pipeline;
+    template <class U_>
+    friend class PipelineBuilder;
+
+    Pipeline pipeline;
+
+    PipelineBuilder(Pipeline&& pipeline)
+      : pipeline(std::move(pipeline))
+    { }
+  public:
+    template <class Func_, class Out_ = typename std::decay<decltype(std::declval<Func_&>()(std::declval<T_>()))>::type>
+    inline PipelineBuilder<Out_> then(StageMode mode, Func_ func)
+    {
+        this->pipeline.addStage(std::unique_ptr<PipelineStage>(new TransformStage<T_, Out_, Func_>(mode, std::move(func))));
+        return PipelineBuilder<Out_>(std::move(this->pipeline));
+    }
+
+    template <class Func_>
+    inline Pipeline sink(StageMode mode, Func_ func)
+    {
+        this->pipeline.addStage(std::unique_ptr<PipelineStage>(new SinkStage<T_, Func_>(mode, std::move(func))));
+        return std::move(this->pipeline);
+    }
+};
+
+} // end namespace detail
+
+} // end namespace ride
@@ -6,26 +6,38 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include <ride/concurrency/detail/blocking_region.hpp>
+#include <ride/concurrency/detail/event_count.hpp>
 #include <ride/concurrency/detail/job.hpp>
-#include <ride/concurrency/container/deque.hpp>
 #include <ride/concurrency/detail/pass_keys.hpp>
+#include <ride/concurrency/detail/rejection_policy.hpp>
+#include <ride/concurrency/detail/work_deque.hpp>
+#include <ride/concurrency/detail/worker_local.hpp>
 
 namespace ride { namespace detail {
 
 class WorkerThread;
+class WorkerQueue;
 class AbstractWorkerThreadFactory;
 class Barrier;
+template <class T_>
+class WorkerLocal;
 
 class ThreadPool
   : public std::enable_shared_from_this<ThreadPool>
 {
   public:
     typedef std::unique_ptr<AbstractJob> PolymorphicJob;
-    typedef ConcurrentDeque<PolymorphicJob> WorkContainer;
+    typedef WorkDeque WorkContainer;
     typedef std::unique_ptr<WorkerThread> PolymorphicWorker;
     typedef std::shared_ptr<AbstractWorkerThreadFactory> PolymorphicWorkerFactory;
   private:
@@ -33,13 +45,38 @@ class ThreadPool
     typedef std::unique_lock<Mutex> Lock;
     typedef std::unique_ptr<Lock> LockPtr;
     typedef std::lock_guard<Mutex> LockGuard;
+    typedef std::vector<std::shared_ptr<WorkerQueue>> LocalQueues;
 
     WorkContainer work;
+    std::atomic<RejectionPolicy> rejection_policy;
     mutable Mutex thread_management;
     StartWorkerKey starterKey;
+    HelpWorkerKey helperKey;
+    PoolWorkerKey callerKey;
+    LocalJobKey localKey;
     std::atomic_size_t num_pseudo_workers, num_alive_workers;
+    // workers waiting on the deque, jobs submitted by workers skip their local queue while any are
+    std::atomic_size_t num_idle_workers;
+    // local queues are bypassed while paused so pausing only has to hold back the deque
+    std::atomic_bool work_paused;
+    // a job is counted in the epoch it was submitted in, a wait moves submissions on
+    // to the other epoch and waits for the one it left to drain, so jobs submitted
+    // during the wait can neither hold it up nor stand in for earlier ones
+    std::atomic_size_t pending_jobs[2];
+    std::atomic_uint submit_epoch;
+    // waits take turns, each one moves the epoch on
+    Mutex wait_mutex;
+    EventCount quiescence;
     std::shared_ptr<Barrier> join_barrier;
     std::unordered_map<std::thread::id, PolymorphicWorker> workers;
+    // the workers' local queues, replaced whenever a worker comes or goes and read
+    // under a hazard pointer, so stealing never takes thread_management
+    std::atomic<const LocalQueues*> local_queues;
+    // used to start compensating workers while a worker is inside a blocking region
+    PolymorphicWorkerFactory worker_factory;
+    std::size_t max_threads, num_compensating_workers;
+    // one per registered worker local, indexed by its slot
+    std::vector<WorkerLocalFactory> local_factories;
 
     std::pair<std::thread::id, PolymorphicWorker> createWorker(PolymorphicWorkerFactory factory);
 
@@ -47,12 +84,15 @@ class ThreadPool
 
     std::size_t unsafeRemovePseudoWorkers(std::size_t to_remove, LockPtr lock);
 
+    // thread_management must be held
+    void unsafePublishLocalQueues();
+
     inline void unsafeRemoveWorkersNow(std::size_t to_remove, LockPtr lock)
     {
         to_remove = unsafeRemovePseudoWorkers(to_remove, std::move(lock));
 
         for (std::size_t i = 0; i < to_remove; ++i)
-            this->work.pushFront(this->createPoisonPill(this->join_barrier));
+            this->work.forcePush(this->createPoisonPill(this->join_barrier), true);
     }
 
     inline void unsafeRemoveWorkersLater(std::size_t to_remove, LockPtr lock)
@@ -60,28 +100,90 @@ class ThreadPool
         to_remove = unsafeRemovePseudoWorkers(to_remove, std::move(lock));
 
         for (std::size_t i = 0; i < to_remove; ++i)
-            this->work.pushBack(this->createPoisonPill(this->join_barrier));
+            this->work.forcePush(this->createPoisonPill(this->join_barrier), false);
     }
 
     inline bool unsafeIsCurrentThreadInPool() const
     { return this->workers.find(std::this_thread::get_id()) != this->workers.end(); }
 
-    void safeJoin(bool remove_workers);
+    // doesn't need the lock, workers know which thread they are running on
+    WorkerThread* getCurrentWorker() const;
+
+    // hand every local job to the deque, returning how many were moved
+    std::size_t spillAllLocalJobs();
+
+    bool runPendingJob(WorkerThread* worker);
+
+    // how long a helping worker sleeps on the awaited result when no job is ready
+    static inline std::chrono::microseconds helpInterval()
+    { return std::chrono::microseconds(100); }
+
+    void safeJoin();
+
+    inline void addPendingJob(AbstractJob& job)
+    {
+        job.epoch = static_cast<unsigned char>(this->submit_epoch.load(std::memory_order_seq_cst));
+        this->pending_jobs[job.epoch].fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // a fence and a load whenever an epoch drains or work is paused while nobody waits
+    inline void finishPendingJob(const AbstractJob& job)
+    {
+        if (this->pending_jobs[job.epoch].fetch_sub(1, std::memory_order_seq_cst) == 1
+                || this->work_paused.load(std::memory_order_seq_cst))
+            this->quiescence.notifyAll();
+    }
+
+    // a job being submitted is counted as taken until it's queued
+    inline void finishQueuingJob()
+    {
+        if (this->work_paused.load(std::memory_order_seq_cst))
+            this->quiescence.notifyAll();
+    }
+
+    void waitForEpoch(unsigned epoch);
+
+    // pending jobs that aren't queued anymore, only shrinks while work is paused
+    std::size_t numTakenJobs() const;
 
     inline void synchronizeWorkers(std::size_t num_workers, std::shared_ptr<Barrier> barrier)
     {
         for (std::size_t i = 0; i < num_workers; ++i)
-            this->work.pushBack(this->createSyncPill(barrier));
+            this->work.forcePush(this->createSyncPill(barrier), false);
     }
 
     std::size_t setupBarrier(std::shared_ptr<Barrier>& barrier) const;
 
+    inline std::size_t addWorkerLocal(WorkerLocalFactory factory)
+    {
+        LockGuard lock(this->thread_management);
+
+        this->local_factories.push_back(std::move(factory));
+        return this->local_factories.size() - 1;
+    }
+
+    void submit(PolymorphicJob&& job, bool priority);
+    void queue(PolymorphicJob&& job, bool priority);
+
     static inline PolymorphicJob createPoisonPill(std::shared_ptr<Barrier> barrier)
     { return PolymorphicJob(new PoisonJob(barrier)); }
 
     static inline PolymorphicJob createSyncPill(std::shared_ptr<Barrier> barrier)
     { return PolymorphicJob(new SynchronizeJob(barrier)); }
   protected:
+    // workers asking for a job wait until the work is resumed, pills excepted
+    void pauseWork();
+
+    inline void resumeWork()
+    {
+        this->work.setPaused(false);
+        this->work_paused = false;
+    }
+
+    // while work is paused, wait for the jobs taken before it to finish, a job can't
+    // wait for itself so it isn't called from one
+    void waitForTakenJobs();
+
     inline virtual void afterExecuteJob() { }
     inline virtual void beforeExecuteJob() { }
     inline virtual void onStartupWorker() { }
@@ -90,13 +192,25 @@ class ThreadPool
     inline virtual void onSynchronizeWorker() { }
   public:
     ThreadPool()
-      : num_pseudo_workers(0)
+      : rejection_policy(RejectionPolicy::Block)
+      , num_pseudo_workers(0)
       , num_alive_workers(0)
+      , num_idle_workers(0)
+      , work_paused(false)
+      , submit_epoch(0)
       , join_barrier(nullptr)
-    { }
+      , local_queues(new LocalQueues())
+      , worker_factory(nullptr)
+      , max_threads(std::max(std::thread::hardware_concurrency(), 1u) * 4)
+      , num_compensating_workers(0)
+    {
+        this->pending_jobs[0].store(0, std::memory_order_relaxed);
+        this->pending_jobs[1].store(0, std::memory_order_relaxed);
+    }
 
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator = (const ThreadPool&) = delete;
+    virtual ~ThreadPool();
 
     template <class Func_, class Ret_ = typename JobResultType<Func_>::type>
     inline static std::unique_ptr<Job<Ret_>> createJob(Func_ function)
@@ -122,11 +236,11 @@ class ThreadPool
 
     template <class T_>
     inline void addJob(std::unique_ptr<Job<T_>>&& job_ptr)
-    { this->work.pushBack(std::move(job_ptr)); }
+    { this->submit(std::move(job_ptr), false); }
 
     template <class T_>
     inline void addPriorityJob(std::unique_ptr<Job<T_>>&& job_ptr)
-    { this->work.pushFront(std::move(job_ptr)); }
+    { this->submit(std::move(job_ptr), true); }
 
     inline void removeWorkers(std::size_t to_remove)
     {
@@ -158,27 +272,109 @@ class ThreadPool
         this->unsafeAddWorkers(to_create, factory, std::move(lock));
     }
 
+    // caps the number of threads blocking regions may grow the pool to
+    inline void setMaxThreads(std::size_t max_threads)
+    {
+        LockGuard lock(this->thread_management);
+        this->max_threads = max_threads;
+    }
+
+    inline std::size_t maxThreads() const
+    {
+        LockGuard lock(this->thread_management);
+        return this->max_threads;
+    }
+
+    inline std::size_t numCompensatingWorkers() const
+    {
+        LockGuard lock(this->thread_management);
+        return this->num_compensating_workers;
+    }
+
+    // gives every worker its own value, created by init when the worker starts
+    // and destroyed on its thread when it shuts down, workers already running
+    // create theirs the first time a job asks for it
+    //
+    // if init throws, that worker has no value and get() rethrows the exception there
+    //
+    // registered for the pool's lifetime, there is no way to remove one
+    template <class T_, class Init_>
+    inline WorkerLocal<T_> registerWorkerLocal(Init_ init)
+    {
+        return WorkerLocal<T_>(*this, this->addWorkerLocal([init]() {
+            return std::unique_ptr<WorkerLocalSlot>(new WorkerLocalValue<T_>(init()));
+        }));
+    }
+
+    template <class T_>
+    inline WorkerLocal<T_> registerWorkerLocal()
+    {
+        return WorkerLocal<T_>(*this, this->addWorkerLocal([]() {
+            return std::unique_ptr<WorkerLocalSlot>(new WorkerLocalValue<T_>());
+        }));
+    }
+
+    // run a function that is about to block, letting the pool start a
+    // compensating worker for the duration when called from a worker
+    template <class Func_>
+    inline auto blocking(Func_ function) -> decltype(function())
+    {
+        BlockingRegion region(*this);
+        return function();
+    }
+
     inline std::size_t numWorkers() const
     { return this->num_pseudo_workers; }
     inline std::size_t numAliveWorkers() const
     { return this->num_alive_workers; }
-    inline std::size_t remainingJobs() const
-    { return this->work.size(); }
+    // counts the jobs waiting in the workers' local queues too
+    std::size_t remainingJobs() const;
     inline bool hasWork() const
-    { return !this->work.isEmpty(); }
-    inline void clearJobs()
-    { this->work.clear(); }
+    { return this->remainingJobs() != 0; }
+    // pills stay queued so joins and synchronizations still complete, and so do
+    // the internal jobs strands and the like schedule for themselves
+    void clearJobs();
+
+    // bound the number of queued jobs, zero makes the pool unbounded again
+    inline void setJobCapacity(std::size_t capacity, RejectionPolicy policy = RejectionPolicy::Block)
+    {
+        this->rejection_policy = policy;
+        this->work.setCapacity(capacity);
+    }
+
+    inline std::size_t jobCapacity() const
+    { return this->work.getCapacity(); }
+
+    inline RejectionPolicy rejectionPolicy() const
+    { return this->rejection_policy; }
 
     inline void join()
-    { safeJoin(true); }
-    inline void wait()
-    { safeJoin(false); }
+    { safeJoin(); }
+    // wait until every job submitted before the call finished, without stopping
+    // the workers, jobs submitted meanwhile don't hold it back
+    void wait();
+    // make every worker meet at a barrier, calling the synchronize hooks
     void sync();
 
     inline bool isCurrentThreadInPool() const
+    { return this->getCurrentWorker() != nullptr; }
+
+    // wait for a future of this pool, running other queued jobs meanwhile
+    // when called from one of the workers so nested waits can't starve the pool
+    template <class Future_>
+    inline void waitFor(const Future_& future)
     {
-        LockGuard lock(this->thread_management);
-        return unsafeIsCurrentThreadInPool();
+        WorkerThread* worker = this->getCurrentWorker();
+
+        if (!worker)
+        {
+            future.wait();
+            return;
+        }
+
+        while (future.wait_for(std::chrono::seconds::zero()) != std::future_status::ready)
+            if (!this->runPendingJob(worker))
+                future.wait_for(helpInterval());
     }
   public: // private key APIs
     inline void getJob(const PoolWorkerKey&, PolymorphicJob&& job)
@@ -187,6 +383,9 @@ class ThreadPool
     inline bool tryGetJob(const PoolWorkerKey&, PolymorphicJob&& job, std::try_to_lock_t)
     { return this->work.tryPopFront(std::move(job)); }
 
+    inline void returnJob(const PoolWorkerKey&, PolymorphicJob&& job)
+    { this->work.forcePush(std::move(job), true); }
+
     template <class Rep_, class Period_>
     inline bool tryGetJob(const PoolWorkerKey&, PolymorphicJob&& job, const std::chrono::duration<Rep_, Period_>& duration)
     { return this->work.tryPopFrontFor(std::move(job), duration); }
@@ -195,6 +394,41 @@ class ThreadPool
     inline bool tryGetJob(const PoolWorkerKey&, PolymorphicJob&& job, const std::chrono::time_point<Clock_, Duration_>& timeout_time)
     { return this->work.tryPopFrontUntil(std::move(job), timeout_time); }
 
+    inline void beginIdle(const PoolWorkerKey&)
+    { this->num_idle_workers.fetch_add(1, std::memory_order_seq_cst); }
+
+    inline void endIdle(const PoolWorkerKey&)
+    { this->num_idle_workers.fetch_sub(1, std::memory_order_relaxed); }
+
+    // local jobs are held back with the deque's while the pool is paused
+    inline bool isWorkPaused(const PoolWorkerKey&) const
+    { return this->work_paused; }
+
+    // take the oldest local job of another worker
+    bool stealJob(const PoolWorkerKey&, WorkerThread& thief, PolymorphicJob&& job);
+
+    void spillJobs(const PoolWorkerKey&, WorkerQueue& local);
+
+    // strands buffer their own jobs, so they aren't subject to the capacity
+    inline void scheduleJob(const ScheduleJobKey&, PolymorphicJob&& job)
+    {
+        AbstractJob& pending = *job;
+        this->addPendingJob(pending);
+
+        try {
+            this->work.forcePush(std::move(job), false);
+        } catch (...) {
+            // still owned by the caller
+            this->finishPendingJob(pending);
+            throw;
+        }
+
+        this->finishQueuingJob();
+    }
+
+    // the handle methods only run the hooks, workers with static hooks skip them
+    // and do the bookkeeping below themselves
+
     inline void handleAfterExecuteJob(const PoolWorkerKey&)
     { this->afterExecuteJob(); }
 
@@ -202,13 +436,33 @@ class ThreadPool
     { this->beforeExecuteJob(); }
 
     inline void handleOnStartupWorker(const PoolWorkerKey&)
+    { this->onStartupWorker(); }
+
+    inline void handleOnShutdownWorker(const PoolWorkerKey&)
+    { this->onShutdownWorker(); }
+
+    inline void finishJob(const PoolWorkerKey&, const AbstractJob& job)
+    { this->finishPendingJob(job); }
+
+    inline void startedWorker(const PoolWorkerKey&)
+    { ++this->num_alive_workers; }
+
+    // the pool gives up ownership of the worker running on the calling thread
+    PolymorphicWorker releaseWorker(const PoolWorkerKey&);
+
+    // the factories of the worker locals registered from the given slot on
+    inline std::vector<WorkerLocalFactory> workerLocalFactories(const PoolWorkerKey&, std::size_t from) const
     {
-        this->onStartupWorker();
+        LockGuard lock(this->thread_management);
 
-        ++this->num_alive_workers;
+        if (from >= this->local_factories.size())
+            return std::vector<WorkerLocalFactory>();
+        return std::vector<WorkerLocalFactory>(this->local_factories.begin() + from, this->local_factories.end());
     }
 
-    void handleOnShutdownWorker(const PoolWorkerKey&);
+    bool beginBlocking(const BlockingRegionKey&);
+
+    void endBlocking(const BlockingRegionKey&, bool compensated);
 
     inline void handleOnTimeoutWorker(const PoolWorkerKey&)
     { this->onTimeoutWorker(); }
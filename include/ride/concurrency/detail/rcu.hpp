@@ -0,0 +1,147 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <ride/concurrency/detail/cache_line.hpp>
+
+namespace ride { namespace detail {
+
+class RcuDomain;
+
+// one reading thread of a domain, only that thread may call its methods
+//
+// while online the thread may hold on to anything it read from the domain,
+// going offline or passing a quiescent point promises it holds nothing anymore
+class RcuReader
+{
+    friend class RcuDomain;
+
+    // the epoch the reader last announced, zero while offline
+    std::atomic<std::uint64_t> seen;
+    RcuDomain& domain;
+    // nested onlines, only touched by the owning thread
+    unsigned depth;
+    char padding[cacheLineSize - sizeof(std::atomic<std::uint64_t>) - sizeof(RcuDomain*) - sizeof(unsigned)];
+
+    inline void announce();
+  public:
+    explicit RcuReader(RcuDomain& domain)
+      : seen(0)
+      , domain(domain)
+      , depth(0)
+    { }
+
+    RcuReader(const RcuReader&) = delete;
+    RcuReader& operator = (const RcuReader&) = delete;
+    virtual ~RcuReader() = default;
+
+    // nests, only the outermost online and offline change anything
+    inline void online()
+    {
+        if (this->depth++ == 0)
+            this->announce();
+    }
+
+    inline void offline();
+
+    // for long running readers, everything read before this may be reclaimed
+    inline void quiescent()
+    {
+        if (this->depth > 0)
+            this->announce();
+    }
+
+    inline bool isOnline() const
+    { return this->depth > 0; }
+};
+
+// read copy update, writers publish new versions and retire the old ones,
+// which are deleted once every reader that could still see them has moved on
+//
+// reading costs a plain load, the price is paid by writers and by readers
+// announcing themselves, once when going online and once when going offline
+class RcuDomain
+{
+    friend class RcuReader;
+
+    struct Retired
+    {
+        std::uint64_t epoch;
+        void* pointer;
+        void (*deleter)(void*);
+    };
+
+    // starts at one, zero marks an offline reader
+    std::atomic<std::uint64_t> epoch;
+    // set while something is retired, so offline readers only reclaim when it helps
+    std::atomic_bool pending;
+    std::mutex mutex;
+    std::deque<RcuReader> readers;
+    std::vector<RcuReader*> free_readers;
+    std::vector<Retired> retired;
+
+    // the mutex must be held, returns how many are still waiting
+    std::size_t unsafeReclaim();
+
+    void tryReclaim();
+  public:
+    RcuDomain();
+    RcuDomain(const RcuDomain&) = delete;
+    RcuDomain& operator = (const RcuDomain&) = delete;
+
+    // no reader may be online anymore, everything retired is deleted
+    virtual ~RcuDomain();
+
+    // the reader stays valid until it is unregistered
+    RcuReader* registerReader();
+
+    // the reader must be offline
+    void unregisterReader(RcuReader* reader);
+
+    // delete the pointer once no online reader can still be holding it,
+    // it must already be unreachable for readers that come online from now on
+    void retire(void* pointer, void (*deleter)(void*));
+
+    template <class T_>
+    inline void retire(const T_* pointer)
+    { this->retire(const_cast<T_*>(pointer), [](void* object) { delete static_cast<T_*>(object); }); }
+
+    // deletes what can be deleted right now
+    void reclaim();
+
+    // waits until everything retired so far has been deleted,
+    // the calling thread must not be an online reader of this domain
+    void synchronize();
+};
+
+inline void RcuReader::announce()
+{
+    this->seen.store(this->domain.epoch.load(std::memory_order_relaxed), std::memory_order_release);
+    // orders the announcement before the reads that follow it, against retire's scan
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void RcuReader::offline()
+{
+    if (--this->depth > 0)
+        return;
+
+    this->seen.store(0, std::memory_order_release);
+
+    if (this->domain.pending.load(std::memory_order_relaxed))
+        this->domain.tryReclaim();
+}
+
+} // end namespace detail
+
+} // end namespace ride
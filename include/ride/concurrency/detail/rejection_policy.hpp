@@ -0,0 +1,33 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <stdexcept>
+
+namespace ride { namespace detail {
+
+// what a pool does with a job when its work container is full
+enum class RejectionPolicy
+{
+    Block,      // wait for room, or run on the caller when it is a worker of the pool
+    Fail,       // throw RejectedJobError
+    CallerRuns, // run the job on the submitting thread
+    DropOldest  // discard the oldest queued job, breaking its promise, never an internal one
+};
+
+class RejectedJobError
+  : public std::runtime_error
+{
+  public:
+    RejectedJobError()
+      : std::runtime_error("thread pool work container is full")
+    { }
+};
+
+} // end namespace detail
+
+} // end namespace ride
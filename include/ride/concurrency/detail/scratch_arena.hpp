@@ -0,0 +1,289 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define RIDE_CONCURRENCY_HAS_PMR
+#endif
+#endif
+
+namespace ride { namespace detail {
+
+// bump allocation out of chunks, freeing is a no-op and everything allocated after a
+// marker is given back at once by rewinding to it
+//
+// chunks are kept for reuse, so once it has grown to a job's peak usage allocating
+// never reaches the global allocator again, up to a high water mark, whatever a rare
+// big job needed beyond that is given back once it rewound
+//
+// belongs to a single thread, nothing here is synchronized
+class ScratchArena
+{
+    struct Chunk
+    {
+        Chunk* next;
+        std::size_t size;
+
+        inline char* data()
+        { return reinterpret_cast<char*>(this) + sizeof(Chunk); }
+    };
+
+    static constexpr std::size_t initialChunkSize = 64 * 1024;
+    static constexpr std::size_t maxChunkSize = 1024 * 1024;
+  public:
+    // the bytes of chunks trim keeps by default
+    static constexpr std::size_t highWaterMark = 4 * maxChunkSize;
+  private:
+
+    Chunk* first;
+    Chunk* current;
+    // bytes taken from the current chunk
+    std::size_t used;
+
+    inline void* tryAllocate(std::size_t bytes, std::size_t alignment)
+    {
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(this->current->data());
+        std::uintptr_t aligned = (start + this->used + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+
+        if (aligned + bytes > start + this->current->size)
+            return nullptr;
+
+        this->used = aligned + bytes - start;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    inline void addChunk(std::size_t bytes, std::size_t alignment)
+    {
+        std::size_t size = this->current ? this->current->size * 2 : initialChunkSize;
+        if (size > maxChunkSize)
+            size = maxChunkSize;
+        if (size < bytes + alignment)
+            size = bytes + alignment;
+
+        Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+        chunk->next = nullptr;
+        chunk->size = size;
+
+        if (this->current)
+            this->current->next = chunk;
+        else
+            this->first = chunk;
+
+        this->current = chunk;
+        this->used = 0;
+    }
+  public:
+    // a position to rewind to, taken before and restored after every job
+    class Marker
+    {
+        friend class ScratchArena;
+
+        Chunk* chunk;
+        std::size_t used;
+
+        Marker(Chunk* chunk, std::size_t used)
+          : chunk(chunk)
+          , used(used)
+        { }
+    };
+
+    ScratchArena()
+      : first(nullptr)
+      , current(nullptr)
+      , used(0)
+    { }
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator = (const ScratchArena&) = delete;
+
+    ~ScratchArena()
+    { this->release(); }
+
+    inline void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        if (this->current)
+        {
+            if (void* block = this->tryAllocate(bytes, alignment))
+                return block;
+
+            // chunks left over from an earlier job are reused before growing
+            while (this->current->next)
+            {
+                this->current = this->current->next;
+                this->used = 0;
+
+                if (void* block = this->tryAllocate(bytes, alignment))
+                    return block;
+            }
+        }
+
+        this->addChunk(bytes, alignment);
+        return this->tryAllocate(bytes, alignment);
+    }
+
+    inline void deallocate(void*, std::size_t, std::size_t = alignof(std::max_align_t))
+    { }
+
+    inline Marker mark() const
+    { return Marker(this->current, this->used); }
+
+    inline void rewind(const Marker& marker)
+    {
+        // a marker taken before the first chunk existed rewinds to its start
+        this->current = marker.chunk ? marker.chunk : this->first;
+        this->used = marker.chunk ? marker.used : 0;
+    }
+
+    inline void reset()
+    {
+        this->current = this->first;
+        this->used = 0;
+    }
+
+    // gives back the chunks past the first keep bytes, the current chunk and the
+    // ones before it hold what is still allocated and always stay
+    inline void trim(std::size_t keep = highWaterMark)
+    {
+        Chunk** link = &this->first;
+        std::size_t kept = 0;
+        bool past_current = false;
+
+        for (; *link; link = &(*link)->next)
+        {
+            kept += (*link)->size;
+
+            if (past_current && kept > keep)
+                break;
+            if (*link == this->current)
+                past_current = true;
+        }
+
+        while (*link)
+        {
+            Chunk* next = (*link)->next;
+            ::operator delete(*link);
+            *link = next;
+        }
+    }
+
+    // give every chunk back to the system
+    inline void release()
+    {
+        while (this->first)
+        {
+            Chunk* next = this->first->next;
+            ::operator delete(this->first);
+            this->first = next;
+        }
+
+        this->current = nullptr;
+        this->used = 0;
+    }
+};
+
+// lets the standard containers allocate out of an arena
+//
+// nothing allocated through it may outlive the job it was allocated in, not even by
+// leaving as the result of its future, the memory is reused by the next job
+template <class T_>
+class ScratchAllocator
+{
+    template <class U_>
+    friend class ScratchAllocator;
+
+    ScratchArena* arena;
+  public:
+    typedef T_ value_type;
+
+    ScratchAllocator(ScratchArena& arena)
+      : arena(&arena)
+    { }
+
+    template <class U_>
+    ScratchAllocator(const ScratchAllocator<U_>& other)
+      : arena(other.arena)
+    { }
+
+    inline T_* allocate(std::size_t n)
+    {
+        // the size in bytes would wrap around
+        if (n > this->max_size())
+            throw std::bad_array_new_length();
+
+        return static_cast<T_*>(this->arena->allocate(n * sizeof(T_), alignof(T_)));
+    }
+
+    inline void deallocate(T_*, std::size_t)
+    { }
+
+    inline std::size_t max_size() const
+    { return std::numeric_limits<std::size_t>::max() / sizeof(T_); }
+
+    template <class U_>
+    inline bool operator == (const ScratchAllocator<U_>& other) const
+    { return this->arena == other.arena; }
+
+    template <class U_>
+    inline bool operator != (const ScratchAllocator<U_>& other) const
+    { return this->arena != other.arena; }
+};
+
+// the scratch arena of the worker running on this thread, null off the pool,
+// the same as WorkerThread::currentScratch for code that can't see the worker
+ScratchArena* currentScratchArena();
+
+#ifdef RIDE_CONCURRENCY_HAS_PMR
+
+class ScratchResource
+  : public std::pmr::memory_resource
+{
+    ScratchArena& arena;
+
+    inline void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    { return this->arena.allocate(bytes, alignment); }
+
+    inline void do_deallocate(void*, std::size_t, std::size_t) override
+    { }
+
+    inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    { return this == &other; }
+  public:
+    ScratchResource(ScratchArena& arena)
+      : arena(arena)
+    { }
+};
+
+// the scratch arena as a memory resource, the default resource off the pool
+//
+// like with ScratchAllocator, the memory must not escape the job that allocated it
+//
+// a free function rather than a member of WorkerThread, so the worker looks the
+// same to every translation unit whatever standard it is compiled with
+inline std::pmr::memory_resource* currentScratchResource()
+{
+    ScratchArena* arena = currentScratchArena();
+
+    if (!arena)
+        return std::pmr::get_default_resource();
+
+    // a thread is only ever the one worker, so the resource can stay bound to it
+    static thread_local ScratchResource resource(*arena);
+    return &resource;
+}
+
+#endif
+
+} // end namespace detail
+
+} // end namespace ride
@@ -0,0 +1,224 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <ride/concurrency/container/channel.hpp>
+#include <ride/concurrency/detail/pool.hpp>
+
+namespace ride { namespace detail {
+
+// waits on several channels at once, running the handler of the first case that is ready
+//
+// the cases are kept, so a select can be waited on again and again, but only from one
+// thread at a time and never while it is scheduled on a pool
+//
+// a case whose channel is closed for good is skipped, once they all are a wait returns closed
+class Select
+{
+  public:
+    // returned when nothing was ready in time
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max() - 1;
+    // returned when every case's channel is closed
+    static constexpr std::size_t closed = std::numeric_limits<std::size_t>::max();
+  private:
+    enum class Result { Fired, NotReady, Dead };
+
+    class Case
+    {
+      public:
+        Case() = default;
+        Case(const Case&) = delete;
+        Case& operator = (const Case&) = delete;
+        virtual ~Case() = default;
+
+        // runs the handler if the case is ready, never waits
+        virtual Result tryFire() = 0;
+        virtual void subscribe(ChannelWaiter& waiter) = 0;
+        virtual void unsubscribe(ChannelWaiter& waiter) = 0;
+    };
+
+    template <class T_, class Handler_>
+    class ReceiveCase final
+      : public Case
+    {
+        Channel<T_>& channel;
+        Handler_ handler;
+      public:
+        ReceiveCase(Channel<T_>& channel, Handler_ handler)
+          : channel(channel)
+          , handler(std::move(handler))
+        { }
+
+        inline Result tryFire() override
+        {
+            T_ value;
+
+            if (this->channel.tryReceive(value))
+            {
+                this->handler(std::move(value));
+                return Result::Fired;
+            }
+
+            // nothing can be sent after closing, so a drained channel stays that way
+            return this->channel.isDrained() ? Result::Dead : Result::NotReady;
+        }
+
+        inline void subscribe(ChannelWaiter& waiter) override
+        { this->channel.subscribeReceive(waiter); }
+
+        inline void unsubscribe(ChannelWaiter& waiter) override
+        { this->channel.unsubscribeReceive(waiter); }
+    };
+
+    template <class T_, class Handler_>
+    class SendCase final
+      : public Case
+    {
+        Channel<T_>& channel;
+        T_ value;
+        Handler_ handler;
+      public:
+        SendCase(Channel<T_>& channel, T_ value, Handler_ handler)
+          : channel(channel)
+          , value(std::move(value))
+          , handler(std::move(handler))
+        { }
+
+        inline Result tryFire() override
+        {
+            if (this->channel.trySend(this->value))
+            {
+                this->handler();
+                return Result::Fired;
+            }
+
+            return this->channel.isClosed() ? Result::Dead : Result::NotReady;
+        }
+
+        inline void subscribe(ChannelWaiter& waiter) override
+        { this->channel.subscribeSend(waiter); }
+
+        inline void unsubscribe(ChannelWaiter& waiter) override
+        { this->channel.unsubscribeSend(waiter); }
+    };
+
+    class BlockingWaiter final
+      : public ChannelWaiter
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool notified;
+      public:
+        BlockingWaiter()
+          : notified(false)
+        { }
+
+        inline void notify() override
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            this->notified = true;
+            this->condition.notify_one();
+        }
+
+        // called before looking at the cases, so a change while looking isn't missed
+        inline void reset()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->notified = false;
+        }
+
+        inline void wait()
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]() { return this->notified; });
+        }
+
+        inline bool waitUntil(std::chrono::steady_clock::time_point timeout_time)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            return this->condition.wait_until(lock, timeout_time, [this]() { return this->notified; });
+        }
+    };
+
+    class Scheduled;
+    class ScheduledJob;
+
+    std::vector<std::unique_ptr<Case>> cases;
+    // the case looked at first, moved along so a busy channel can't starve the others
+    std::size_t first_case;
+
+    std::size_t tryOnce();
+
+    void subscribe(ChannelWaiter& waiter);
+
+    void unsubscribe(ChannelWaiter& waiter);
+
+    std::size_t waitUntil(const std::chrono::steady_clock::time_point* timeout_time);
+
+    // like strands, the capacity is no reason to hold back a select that became ready
+    static void submit(ThreadPool& pool, std::shared_ptr<Scheduled> scheduled);
+  public:
+    Select()
+      : first_case(0)
+    { }
+
+    Select(const Select&) = delete;
+    Select& operator = (const Select&) = delete;
+
+    // the handler gets every value received through this case
+    template <class T_, class Handler_>
+    inline Select& receive(Channel<T_>& channel, Handler_ handler)
+    {
+        this->cases.emplace_back(new ReceiveCase<T_, Handler_>(channel, std::move(handler)));
+        return *this;
+    }
+
+    // sends a copy of the value each time this case fires, then calls the handler
+    //
+    // on an unbuffered channel it only fires for a receiver blocked in a receive,
+    // a select receiving on the same channel isn't enough
+    template <class T_, class Handler_>
+    inline Select& send(Channel<T_>& channel, T_ value, Handler_ handler)
+    {
+        this->cases.emplace_back(new SendCase<T_, Handler_>(channel, std::move(value), std::move(handler)));
+        return *this;
+    }
+
+    // the index of the case that fired, in the order they were added
+    inline std::size_t wait()
+    { return this->waitUntil(nullptr); }
+
+    // returns none instead of waiting
+    inline std::size_t tryWait()
+    { return this->tryOnce(); }
+
+    template <class Rep_, class Period_>
+    inline std::size_t tryWaitFor(const std::chrono::duration<Rep_, Period_>& duration)
+    { return this->tryWaitUntil(std::chrono::steady_clock::now() + duration); }
+
+    inline std::size_t tryWaitUntil(std::chrono::steady_clock::time_point timeout_time)
+    { return this->waitUntil(&timeout_time); }
+
+    // waits without a thread, the handler of the case that fires runs as a job on the pool
+    //
+    // the select and its channels have to outlive the returned future becoming ready
+    std::future<std::size_t> schedule(std::shared_ptr<ThreadPool> pool);
+};
+
+} // end namespace detail
+
+} // end namespace ride
@@ -20,8 +20,9 @@ class BarrierJob
     BarrierJob() = delete;
     virtual ~BarrierJob() = default;
 
-    BarrierJob(std::shared_ptr<Barrier> barrier)
-      : barrier(barrier)
+    BarrierJob(Kind kind, std::shared_ptr<Barrier> barrier)
+      : AbstractJob(kind)
+      , barrier(barrier)
     { }
 };
 
@@ -29,34 +30,28 @@ class SynchronizeJob
   : public BarrierJob
 {
   public:
-    using BarrierJob::BarrierJob;
+    SynchronizeJob(std::shared_ptr<Barrier> barrier)
+      : BarrierJob(Kind::Sync, barrier)
+    { }
+
     virtual ~SynchronizeJob() = default;
 
     inline void operator()(const ride::detail::PoolWorkerKey&) override
     { this->barrier->count_down_and_wait(); }
-
-    inline bool isPoison() const override
-    { return false; }
-
-    inline bool isSync() const final override
-    { return true; }
 };
 
 class PoisonJob
   : public BarrierJob
 {
   public:
-    using BarrierJob::BarrierJob;
+    PoisonJob(std::shared_ptr<Barrier> barrier)
+      : BarrierJob(Kind::Poison, barrier)
+    { }
+
     virtual ~PoisonJob() = default;
 
     inline void operator()(const ride::detail::PoolWorkerKey&) override
     { if (this->barrier) this->barrier->count_down(); }
-
-    inline bool isSync() const override
-    { return false; }
-
-    inline bool isPoison() const final override
-    { return true; }
 };
 
 } // end namespace detail
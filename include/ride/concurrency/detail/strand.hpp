@@ -0,0 +1,145 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include <ride/concurrency/detail/pool.hpp>
+
+namespace ride { namespace detail {
+
+// jobs added to a strand run one at a time in the order they were added,
+// while separate strands share the workers of the pool
+class Strand
+  : public std::enable_shared_from_this<Strand>
+{
+  public:
+    typedef ThreadPool::PolymorphicJob PolymorphicJob;
+  private:
+    typedef std::mutex Mutex;
+    typedef std::unique_lock<Mutex> Lock;
+    typedef std::lock_guard<Mutex> LockGuard;
+
+    std::shared_ptr<ThreadPool> pool;
+    ScheduleJobKey scheduleKey;
+    mutable Mutex mutex;
+    std::queue<PolymorphicJob> pending;
+    // true while the strand has a job in the pool, so at most one is ever queued
+    bool scheduled;
+
+    void schedule();
+
+    void enqueue(PolymorphicJob&& job);
+
+    // scheduling hands out shared_from_this, so a strand only ever lives in a shared_ptr
+    Strand(std::shared_ptr<ThreadPool> pool)
+      : pool(pool)
+      , scheduled(false)
+    { }
+  public:
+    Strand() = delete;
+    Strand(const Strand&) = delete;
+    Strand& operator = (const Strand&) = delete;
+    virtual ~Strand() = default;
+
+    static inline std::shared_ptr<Strand> create(std::shared_ptr<ThreadPool> pool)
+    { return std::shared_ptr<Strand>(new Strand(pool)); }
+
+    template <class Func_, class Ret_ = typename JobResultType<Func_>::type>
+    inline std::future<Ret_> emplaceJob(Func_ function)
+    {
+        std::unique_ptr<Job<Ret_>> job = ThreadPool::createJob(function);
+        std::future<Ret_> future = job->getFuture();
+        addJob(std::move(job));
+        return future;
+    }
+
+    template <class T_>
+    inline void addJob(std::unique_ptr<Job<T_>>&& job_ptr)
+    { this->enqueue(std::move(job_ptr)); }
+
+    inline std::size_t remainingJobs() const
+    {
+        LockGuard lock(this->mutex);
+        return this->pending.size();
+    }
+
+    inline bool isActive() const
+    {
+        LockGuard lock(this->mutex);
+        return this->scheduled;
+    }
+
+    inline std::shared_ptr<ThreadPool> getPool() const
+    { return this->pool; }
+  public: // private key APIs
+    void runNext(const PoolWorkerKey& key);
+};
+
+class StrandJob
+  : public AbstractJob
+{
+    std::shared_ptr<Strand> strand;
+  public:
+    StrandJob() = delete;
+    virtual ~StrandJob() = default;
+
+    StrandJob(std::shared_ptr<Strand> strand)
+      : AbstractJob(Kind::Internal)
+      , strand(strand)
+    { }
+
+    inline void operator()(const PoolWorkerKey& key) override
+    { this->strand->runNext(key); }
+};
+
+// maps keys onto a fixed set of strands, so jobs sharing a key never overlap
+// distinct keys that hash to the same strand are serialized with each other
+template <class Key_, class Hash_ = std::hash<Key_>>
+class KeyedStrands
+{
+    std::vector<std::shared_ptr<Strand>> strands;
+    Hash_ hasher;
+  public:
+    KeyedStrands() = delete;
+    KeyedStrands(const KeyedStrands&) = delete;
+    KeyedStrands& operator = (const KeyedStrands&) = delete;
+    virtual ~KeyedStrands() = default;
+
+    KeyedStrands(std::shared_ptr<ThreadPool> pool, std::size_t num_strands, Hash_ hasher = Hash_())
+      : hasher(hasher)
+    {
+        num_strands = std::max<std::size_t>(num_strands, 1);
+
+        this->strands.reserve(num_strands);
+        for (std::size_t i = 0; i < num_strands; ++i)
+            this->strands.push_back(Strand::create(pool));
+    }
+
+    inline Strand& strandFor(const Key_& key)
+    { return *this->strands[this->hasher(key) % this->strands.size()]; }
+
+    template <class Func_, class Ret_ = typename JobResultType<Func_>::type>
+    inline std::future<Ret_> emplaceJob(const Key_& key, Func_ function)
+    { return this->strandFor(key).emplaceJob(function); }
+
+    template <class T_>
+    inline void addJob(const Key_& key, std::unique_ptr<Job<T_>>&& job_ptr)
+    { this->strandFor(key).addJob(std::move(job_ptr)); }
+
+    inline std::size_t numStrands() const
+    { return this->strands.size(); }
+};
+
+} // end namespace detail
+
+} // end namespace ride
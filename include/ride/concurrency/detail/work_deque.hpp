@@ -0,0 +1,157 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <ride/concurrency/container/detail/bidirectional_container.hpp>
+#include <ride/concurrency/detail/abstract_job.hpp>
+
+namespace ride { namespace detail {
+
+// the pool's work container, adding the operations rejection policies need
+class WorkDeque final
+  : public BidirectionalConcurrentContainer<std::unique_ptr<AbstractJob>, std::deque<std::unique_ptr<AbstractJob>>, WorkDeque>
+{
+    // the container looks up the refined wait at compile time
+    friend class SafeConcurrentContainer<WorkDeque>;
+
+    typedef BidirectionalConcurrentContainer<std::unique_ptr<AbstractJob>, std::deque<std::unique_ptr<AbstractJob>>, WorkDeque> Base;
+  public:
+    typedef std::unique_ptr<AbstractJob> PolymorphicJob;
+  private:
+    // only read and written with the container's lock held
+    bool paused;
+    static inline bool isSpecial(const PolymorphicJob& job)
+    { return job->isPoisonPill() || job->isSyncPill(); }
+    // jobs that can't be dropped or cleared
+    static inline bool isKept(const PolymorphicJob& job)
+    { return isSpecial(job) || job->isInternal(); }
+
+    // while paused only pills at the front may be taken, so a paused pool can still shut down
+    inline bool wait(Lock& lock, std::try_to_lock_t) const
+    {
+        return Base::wait(lock, std::try_to_lock)
+                && (!this->paused || isSpecial(this->data.front()));
+    }
+
+    inline void unsafeAdd(PolymorphicJob&& job, bool front)
+    {
+        if (front)
+            this->data.push_front(std::move(job));
+        else
+            this->data.push_back(std::move(job));
+    }
+  public:
+    WorkDeque()
+      : paused(false)
+    { }
+
+    // stop handing out jobs, workers asking for one wait until resumed
+    inline void setPaused(bool paused)
+    {
+        Lock lock(this->mutex);
+
+        this->paused = paused;
+        if (!paused)
+            this->notifyElements();
+
+        lock.unlock();
+    }
+
+    // add ignoring the capacity, for pills and jobs that are already accounted for
+    inline void forcePush(PolymorphicJob&& job, bool front)
+    {
+        Lock lock(this->mutex);
+        this->unsafeAdd(std::move(job), front);
+        this->finishSafeAdd(lock);
+    }
+
+    // forcePush for each job at once, in order, moving them out of jobs
+    template <class Jobs_>
+    inline void forcePushAll(Jobs_& jobs)
+    {
+        if (jobs.empty())
+            return;
+
+        Lock lock(this->mutex);
+
+        for (PolymorphicJob& job : jobs)
+            this->data.push_back(std::move(job));
+
+        this->finishSafeBulkAdd(lock);
+        jobs.clear();
+    }
+
+    // add only if there is room, waiting for the lock but never for room
+    inline bool offer(PolymorphicJob&& job, bool front)
+    {
+        Lock lock(this->mutex);
+
+        if (!this->unsafeHasRoom())
+        {
+            lock.unlock();
+            return false;
+        }
+
+        this->unsafeAdd(std::move(job), front);
+        this->finishSafeAdd(lock);
+        return true;
+    }
+
+    // move every job that isn't a pill or internal to removed
+    inline void clearJobs(std::vector<PolymorphicJob>& removed)
+    {
+        Lock lock(this->mutex);
+
+        auto kept = std::stable_partition(this->data.begin(), this->data.end(), isKept);
+        std::move(kept, this->data.end(), std::back_inserter(removed));
+        this->data.erase(kept, this->data.end());
+
+        this->notifyRoom();
+        lock.unlock();
+    }
+
+    // the queued jobs that aren't pills, a scan, so only for the rare check
+    inline std::size_t numJobs() const
+    {
+        Lock lock(this->mutex);
+
+        std::size_t jobs = std::count_if(this->data.begin(), this->data.end(),
+                [](const PolymorphicJob& job) { return !isSpecial(job); });
+
+        lock.unlock();
+        return jobs;
+    }
+
+    // add, making room by removing the oldest job that isn't a pill or internal
+    inline void pushDroppingOldest(PolymorphicJob&& job, bool front, PolymorphicJob& dropped)
+    {
+        Lock lock(this->mutex);
+
+        if (!this->unsafeHasRoom())
+        {
+            auto oldest = std::find_if_not(this->data.begin(), this->data.end(), isKept);
+            if (oldest != this->data.end())
+            {
+                dropped = std::move(*oldest);
+                this->data.erase(oldest);
+            }
+        }
+
+        this->unsafeAdd(std::move(job), front);
+        this->finishSafeAdd(lock);
+    }
+};
+
+} // end namespace detail
+
+} // end namespace ride
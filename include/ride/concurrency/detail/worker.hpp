@@ -6,57 +6,124 @@
 
 #pragma once
 
+#include <stdexcept>
+#include <vector>
+
 #include <ride/concurrency/detail/pool.hpp>
+#include <ride/concurrency/detail/scratch_arena.hpp>
+#include <ride/concurrency/detail/worker_queue.hpp>
 
 namespace ride { namespace detail {
 
 class WorkerThread
 {
     PoolWorkerKey key;
+    // the worker running on this thread, if any
+    static thread_local WorkerThread* current;
+    // jobs this worker submitted to its own pool, shared with the pool's list of queues
+    // so a thief holding that list can't outlive it
+    std::shared_ptr<WorkerQueue> local;
+    std::size_t local_ticks;
+    // temporaries of the running job, rewound once it returns
+    ScratchArena scratch;
+    // this worker's values of the pool's worker locals, indexed by slot
+    std::vector<std::unique_ptr<WorkerLocalSlot>> locals;
   protected:
     std::shared_ptr<ThreadPool> pool;
     bool is_finished;
     std::unique_ptr<std::thread> thread;
   private:
-    void run();
-
-    inline void handleBeforeExecute()
+    // the hooks of this worker and its pool, resolved at run time
+    class VirtualHooks
     {
-        this->beforeExecute();
-        this->pool->handleBeforeExecuteJob(key);
-    }
+        WorkerThread& worker;
+      public:
+        VirtualHooks(WorkerThread& worker)
+          : worker(worker)
+        { }
 
-    inline void handleAfterExecute()
-    {
-        this->afterExecute();
-        this->pool->handleAfterExecuteJob(key);
-    }
+        inline void beforeExecute()
+        {
+            this->worker.beforeExecute();
+            this->worker.pool->handleBeforeExecuteJob(this->worker.key);
+        }
+
+        inline void afterExecute()
+        {
+            this->worker.afterExecute();
+            this->worker.pool->handleAfterExecuteJob(this->worker.key);
+        }
+
+        inline void onStartup()
+        {
+            this->worker.onStartup();
+            this->worker.pool->handleOnStartupWorker(this->worker.key);
+        }
+
+        inline void onShutdown()
+        {
+            this->worker.onShutdown();
+            this->worker.pool->handleOnShutdownWorker(this->worker.key);
+        }
+
+        inline void onTimeout()
+        {
+            this->worker.onTimeout();
+            this->worker.pool->handleOnTimeoutWorker(this->worker.key);
+        }
 
-    inline void handleOnStartup()
+        inline void onSynchronize()
+        {
+            this->worker.onSynchronize();
+            this->worker.pool->handleOnSynchronizeWorker(this->worker.key);
+        }
+    };
+
+    // the thread's entry point, called once per thread
+    virtual void run()
+    { this->runWith(VirtualHooks(*this)); }
+
+    // how many local jobs run in a row before the pool's deque gets a look
+    static constexpr std::size_t poolCheckInterval = 61;
+
+    bool takeJob(std::unique_ptr<AbstractJob>&& job);
+
+    // creates the values of the worker locals registered since the last call
+    void createLocals();
+
+    inline void destroyLocals()
     {
-        this->onStartup();
-        this->pool->handleOnStartupWorker(key);
+        // in the reverse order of registration, a later one may use an earlier one
+        while (!this->locals.empty())
+            this->locals.pop_back();
     }
 
-    inline void handleOnShutdown()
+    // a nested job only gives back what it allocated itself, the one it
+    // runs inside of keeps its temporaries
+    template <class Hooks_>
+    inline void execute(AbstractJob& job, Hooks_& hooks)
     {
-        this->is_finished = true;
-        this->thread->detach();
+        ScratchArena::Marker marker = this->scratch.mark();
 
-        this->onShutdown();
-        this->pool->handleOnShutdownWorker(key);
-    }
+        hooks.beforeExecute();
+        job(key);
+        hooks.afterExecute();
 
-    inline void handleOnTimeout()
-    {
-        this->onTimeout();
-        this->pool->handleOnTimeoutWorker(key);
+        this->scratch.rewind(marker);
+        this->scratch.trim();
+        this->pool->finishJob(key, job);
     }
 
-    inline void handleOnSynchronize()
+    // the pool gives up ownership of the worker, which must outlive the rest of run()
+    template <class Hooks_>
+    inline std::unique_ptr<WorkerThread> shutdown(Hooks_& hooks)
     {
-        this->onSynchronize();
-        this->pool->handleOnSynchronizeWorker(key);
+        this->is_finished = true;
+        this->thread->detach();
+
+        hooks.onShutdown();
+        this->destroyLocals();
+        return this->pool->releaseWorker(key);
     }
 
     inline virtual void beforeExecute() { }
@@ -76,13 +143,24 @@ class WorkerThread
     template <class Timeout_>
     inline bool tryGetJobFromPool(std::unique_ptr<AbstractJob>&& job, Timeout_&& timeout)
     { return this->pool->tryGetJob(key, std::move(job), std::forward<Timeout_>(timeout)); }
+
+    // the worker loop with the hooks known at compile time, a policy has beforeExecute,
+    // afterExecute, onStartup, onShutdown, onTimeout and onSynchronize
+    template <class Hooks_>
+    void runWith(Hooks_ hooks);
+
+    template <class Hooks_>
+    bool runPendingJobWith(Hooks_ hooks);
   public:
     WorkerThread() = delete;
     WorkerThread(const WorkerThread&) = delete;
     WorkerThread& operator = (const WorkerThread&) = delete;
+    virtual ~WorkerThread() = default;
 
     WorkerThread(std::shared_ptr<ThreadPool> owner)
-      : pool(owner)
+      : local(std::make_shared<WorkerQueue>())
+      , local_ticks(0)
+      , pool(owner)
       , is_finished(false)
       , thread(nullptr)
     { }
@@ -97,8 +175,145 @@ class WorkerThread
 
     inline std::thread::id getId() const
     { return this->thread->get_id(); }
+
+    // the worker running on the calling thread, if it belongs to the pool
+    static inline WorkerThread* currentOf(const ThreadPool& owner)
+    { return current && current->pool.get() == &owner ? current : nullptr; }
+
+    // the scratch arena of the worker running on this thread, null off the pool
+    static inline ScratchArena* currentScratch()
+    { return current ? &current->scratch : nullptr; }
+  public: // private key APIs
+    inline WorkerQueue& localJobs(const LocalJobKey&)
+    { return *this->local; }
+
+    inline std::shared_ptr<WorkerQueue> localQueue(const LocalJobKey&) const
+    { return this->local; }
+
+    inline WorkerLocalSlot& localSlot(const WorkerLocalKey&, std::size_t slot)
+    {
+        if (slot >= this->locals.size())
+            this->createLocals();
+        return *this->locals[slot];
+    }
+
+    // runs one queued job for a job on this worker that is waiting on a result
+    virtual bool runPendingJob(const HelpWorkerKey&)
+    { return this->runPendingJobWith(VirtualHooks(*this)); }
 };
 
+// a job's handle on the value of the worker running it
+template <class T_>
+class WorkerLocal
+{
+    friend class ThreadPool;
+
+    ThreadPool* pool;
+    std::size_t slot;
+
+    WorkerLocal(ThreadPool& pool, std::size_t slot)
+      : pool(&pool)
+      , slot(slot)
+    { }
+
+    inline WorkerLocalSlot* trySlot() const
+    {
+        WorkerThread* worker = WorkerThread::currentOf(*this->pool);
+
+        if (!worker)
+            return nullptr;
+        return &worker->localSlot(WorkerLocalKey(), this->slot);
+    }
+  public:
+    // null when not called from one of the pool's workers or when the init threw there
+    inline T_* tryGet() const
+    {
+        WorkerLocalSlot* slot = this->trySlot();
+
+        if (!slot || slot->error)
+            return nullptr;
+        return &static_cast<WorkerLocalValue<T_>&>(*slot).value;
+    }
+
+    // rethrows what the init threw on this worker
+    inline T_& get() const
+    {
+        WorkerLocalSlot* slot = this->trySlot();
+
+        if (!slot)
+            throw std::logic_error("worker locals are only reachable from the pool's workers");
+        if (slot->error)
+            std::rethrow_exception(slot->error);
+        return static_cast<WorkerLocalValue<T_>&>(*slot).value;
+    }
+};
+
+template <class Hooks_>
+void WorkerThread::runWith(Hooks_ hooks)
+{
+    current = this;
+    this->createLocals();
+    hooks.onStartup();
+    this->pool->startedWorker(key);
+
+    std::unique_ptr<AbstractJob> job = nullptr;
+    bool timedout;
+
+    while (!this->is_finished)
+    {
+        timedout = this->takeJob(std::move(job));
+
+        if (timedout)
+        {
+            hooks.onTimeout();
+            continue;
+        }
+
+        if (!job)
+            continue;
+
+        // local jobs can't wait for a worker that is leaving or stuck at a barrier
+        if (job->isPoisonPill()) {
+            this->pool->spillJobs(key, *this->local);
+            std::unique_ptr<WorkerThread> self = this->shutdown(hooks);
+            current = nullptr;
+            job->operator()(key);
+            return;
+        } else if (job->isSyncPill()) {
+            this->pool->spillJobs(key, *this->local);
+            hooks.onSynchronize();
+            job->operator()(key);
+        } else
+            this->execute(*job, hooks);
+    }
+}
+
+template <class Hooks_>
+bool WorkerThread::runPendingJobWith(Hooks_ hooks)
+{
+    std::unique_ptr<AbstractJob> job = nullptr;
+
+    // the awaited job is most likely the one this worker submitted last
+    if (!this->pool->isWorkPaused(key) && this->local->pop(std::move(job)))
+    {
+        this->execute(*job, hooks);
+        return true;
+    }
+
+    if (!this->tryGetJobFromPool(std::move(job), std::try_to_lock) || !job)
+        return false;
+
+    // poison and sync pills belong to the worker loop, not to a nested wait
+    if (job->isPoisonPill() || job->isSyncPill())
+    {
+        this->pool->returnJob(key, std::move(job));
+        return false;
+    }
+
+    this->execute(*job, hooks);
+    return true;
+}
+
 } // end namespace detail
 
 } // end namespace ride
@@ -0,0 +1,52 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace ride { namespace detail {
+
+// one worker's value of a worker local, the type is only known to its WorkerLocal
+class WorkerLocalSlot
+{
+  public:
+    // what the init threw, the slot holds no value then
+    std::exception_ptr error;
+
+    WorkerLocalSlot() = default;
+
+    explicit WorkerLocalSlot(std::exception_ptr error)
+      : error(error)
+    { }
+
+    WorkerLocalSlot(const WorkerLocalSlot&) = delete;
+    WorkerLocalSlot& operator = (const WorkerLocalSlot&) = delete;
+    virtual ~WorkerLocalSlot() = default;
+};
+
+template <class T_>
+class WorkerLocalValue final
+  : public WorkerLocalSlot
+{
+  public:
+    T_ value;
+
+    template <class... Args_>
+    WorkerLocalValue(Args_&&... args)
+      : value(std::forward<Args_>(args)...)
+    { }
+};
+
+// creates the value of a worker local for a starting worker
+typedef std::function<std::unique_ptr<WorkerLocalSlot>()> WorkerLocalFactory;
+
+} // end namespace detail
+
+} // end namespace ride
@@ -0,0 +1,153 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <ride/concurrency/detail/job.hpp>
+#include <ride/concurrency/detail/work_deque.hpp>
+
+namespace ride { namespace detail {
+
+// jobs submitted by a worker, kept apart from the pool's deque so a parent
+// and its children stay on the same thread while the other workers are busy
+//
+// the newest job waits in a single slot and runs next, older jobs run in the
+// order they were submitted and are the first to be stolen by idle workers
+class WorkerQueue
+{
+  public:
+    typedef std::unique_ptr<AbstractJob> PolymorphicJob;
+  private:
+    typedef std::mutex Mutex;
+    typedef std::lock_guard<Mutex> LockGuard;
+
+    // only contended while another worker is stealing
+    mutable Mutex mutex;
+    PolymorphicJob next;
+    std::deque<PolymorphicJob> jobs;
+    // lets empty queues be skipped without taking the lock
+    std::atomic_size_t count;
+  public:
+    WorkerQueue()
+      : next(nullptr)
+      , count(0)
+    { }
+
+    WorkerQueue(const WorkerQueue&) = delete;
+    WorkerQueue& operator = (const WorkerQueue&) = delete;
+    virtual ~WorkerQueue() = default;
+
+    // only called by the owning worker
+    inline void push(PolymorphicJob&& job)
+    {
+        LockGuard lock(this->mutex);
+
+        if (this->next)
+            this->jobs.push_back(std::move(this->next));
+        this->next = std::move(job);
+
+        this->count.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // only called by the owning worker
+    inline bool pop(PolymorphicJob&& job)
+    {
+        if (this->isEmpty())
+            return false;
+
+        LockGuard lock(this->mutex);
+
+        if (this->next)
+            job = std::move(this->next);
+        else if (!this->jobs.empty())
+        {
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        else
+            return false;
+
+        this->count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // called by other workers, the slot is only taken once the older jobs are gone
+    inline bool steal(PolymorphicJob&& job)
+    {
+        if (this->isEmpty())
+            return false;
+
+        LockGuard lock(this->mutex);
+
+        if (!this->jobs.empty())
+        {
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        else if (this->next)
+            job = std::move(this->next);
+        else
+            return false;
+
+        this->count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // move every job to the back of the pool's deque, oldest first, taking
+    // each lock once and never both at a time
+    inline std::size_t drainTo(WorkDeque& work)
+    {
+        if (this->isEmpty())
+            return 0;
+
+        std::deque<PolymorphicJob> moved;
+
+        {
+            LockGuard lock(this->mutex);
+
+            if (this->next)
+                this->jobs.push_back(std::move(this->next));
+
+            moved.swap(this->jobs);
+            this->count.fetch_sub(moved.size(), std::memory_order_relaxed);
+        }
+
+        std::size_t num_moved = moved.size();
+        work.forcePushAll(moved);
+
+        return num_moved;
+    }
+
+    // moves every job to removed, oldest first
+    inline void clear(std::vector<PolymorphicJob>& removed)
+    {
+        LockGuard lock(this->mutex);
+
+        for (PolymorphicJob& job : this->jobs)
+            removed.push_back(std::move(job));
+        if (this->next)
+            removed.push_back(std::move(this->next));
+
+        this->jobs.clear();
+        this->count.store(0, std::memory_order_seq_cst);
+    }
+
+    inline std::size_t size() const
+    { return this->count.load(std::memory_order_seq_cst); }
+
+    inline bool isEmpty() const
+    { return this->size() == 0; }
+};
+
+} // end namespace detail
+
+} // end namespace ride
@@ -11,27 +11,35 @@
 
 namespace ride {
 
+// pausing is left to the pool, which stops handing out jobs, so a running pool
+// pays nothing for it and the jobs already taken are found by the pool's accounting
 class PausableThreadPool
   : public ThreadPool
 {
     detail::Gate pauser;
-  protected:
-    inline void beforeExecuteJob() override
-    {
-        pauser.wait();
-
-        ThreadPool::beforeExecuteJob();
-    }
   public:
     PausableThreadPool()
         : pauser()
     {}
 
-    inline void pause()
-    { this->pauser.close(); }
+    // workers stop taking jobs, optionally wait for the jobs already taken to finish
+    inline void pause(bool wait_for_running = false)
+    {
+        this->pauser.close();
+        this->pauseWork();
+
+        if (wait_for_running)
+            this->waitForTakenJobs();
+    }
 
     inline void resume()
-    { this->pauser.open(); }
+    {
+        this->resumeWork();
+        this->pauser.open();
+    }
+
+    inline bool isPaused() const
+    { return this->pauser.isClosed(); }
 };
 
 } // end namespace ride
@@ -0,0 +1,72 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <ride/concurrency/thread_pool.hpp>
+#include <ride/concurrency/detail/rcu.hpp>
+
+namespace ride {
+
+// workers are readers of the pool's rcu domain while they run a job,
+// so jobs can read ConcurrentSnapshots of that domain without any locking
+// and the end of every job is a quiescent point
+class RcuThreadPool
+  : public ThreadPool
+{
+    detail::RcuDomain domain;
+
+    // the reader of the worker running on this thread
+    static inline detail::RcuReader*& currentReader()
+    {
+        static thread_local detail::RcuReader* reader = nullptr;
+        return reader;
+    }
+  protected:
+    inline void onStartupWorker() override
+    {
+        currentReader() = this->domain.registerReader();
+
+        ThreadPool::onStartupWorker();
+    }
+
+    inline void onShutdownWorker() override
+    {
+        ThreadPool::onShutdownWorker();
+
+        this->domain.unregisterReader(currentReader());
+        currentReader() = nullptr;
+    }
+
+    // nested jobs keep the reader online for the job they run inside of
+    inline void beforeExecuteJob() override
+    {
+        currentReader()->online();
+
+        ThreadPool::beforeExecuteJob();
+    }
+
+    inline void afterExecuteJob() override
+    {
+        ThreadPool::afterExecuteJob();
+
+        currentReader()->offline();
+    }
+  public:
+    RcuThreadPool() = default;
+
+    inline detail::RcuDomain& getRcuDomain()
+    { return this->domain; }
+
+    // lets a long running job give up the snapshots it read so far
+    static inline void quiescent()
+    {
+        if (detail::RcuReader* reader = currentReader())
+            reader->quiescent();
+    }
+};
+
+} // end namespace ride
@@ -6,9 +6,15 @@
 
 #pragma once
 
+#include <ride/concurrency/detail/completion_queue.hpp>
+#include <ride/concurrency/detail/file_io.hpp>
+#include <ride/concurrency/detail/hooked_pool.hpp>
+#include <ride/concurrency/detail/pipeline.hpp>
+#include <ride/concurrency/detail/select.hpp>
 #include <ride/concurrency/detail/pool.hpp>
 #include <ride/concurrency/detail/worker.hpp>
 #include <ride/concurrency/detail/worker_factory.hpp>
+#include <ride/concurrency/detail/strand.hpp>
 
 namespace ride {
 
@@ -19,6 +25,68 @@ using ThreadPool = detail::ThreadPool;
 
 using WorkerThread = detail::WorkerThread;
 
+using ScratchArena = detail::ScratchArena;
+
+template <class T_>
+using ScratchAllocator = detail::ScratchAllocator<T_>;
+
+#ifdef RIDE_CONCURRENCY_HAS_PMR
+using detail::currentScratchResource;
+#endif
+
+template <class T_>
+using WorkerLocal = detail::WorkerLocal<T_>;
+
+using NoHooks = detail::NoHooks;
+
+template <class Hooks_>
+using HookedThreadPool = detail::HookedThreadPool<Hooks_>;
+
+template <class Hooks_ = NoHooks, class PoolHooks_ = NoHooks>
+using HookedWorkerThread = detail::HookedWorkerThread<Hooks_, PoolHooks_>;
+
+using BlockingRegion = detail::BlockingRegion;
+
+using RejectionPolicy = detail::RejectionPolicy;
+
+using RejectedJobError = detail::RejectedJobError;
+
+using Strand = detail::Strand;
+
+template <class Key_, class Hash_ = std::hash<Key_>>
+using KeyedStrands = detail::KeyedStrands<Key_, Hash_>;
+
+using Pipeline = detail::Pipeline;
+
+using StageMode = detail::StageMode;
+
+using FlowControl = detail::FlowControl;
+
+using PipelineStats = detail::PipelineStats;
+
+using Select = detail::Select;
+
+#ifdef RIDE_CONCURRENCY_HAS_FILE_IO
+
+using FileIO = detail::FileIO;
+
+using FileIOBackend = detail::FileIOBackend;
+
+using FileBatch = detail::FileBatch;
+
+using FileBuffer = detail::FileBuffer;
+
+#endif
+
+#ifdef RIDE_CONCURRENCY_HAS_EVENT_NOTIFIER
+
+using EventNotifier = detail::EventNotifier;
+
+template <class T_>
+using CompletionQueue = detail::CompletionQueue<T_>;
+
+#endif
+
 template <class Worker_ = WorkerThread>
 using WorkerThreadFactory = detail::WorkerThreadFactory<Worker_>;
 
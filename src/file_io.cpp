@@ -0,0 +1,675 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <ride/concurrency/thread_pool.hpp>
+
+#ifdef RIDE_CONCURRENCY_HAS_FILE_IO
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define RIDE_CONCURRENCY_HAS_IO_URING
+#endif
+#endif
+#endif
+
+namespace ride { namespace detail {
+
+namespace {
+
+// the most a single read or write transfers on linux
+constexpr std::size_t maxTransfer = 0x7ffff000;
+
+inline std::int64_t transfer(FileOp& op)
+{
+    std::size_t length = op.length < maxTransfer ? op.length : maxTransfer;
+
+    while (true)
+    {
+        ssize_t transferred = op.kind == FileOpKind::Read || op.kind == FileOpKind::ReadFixed
+            ? ::pread(op.fd, op.buffer, length, static_cast<off_t>(op.offset))
+            : ::pwrite(op.fd, op.buffer, length, static_cast<off_t>(op.offset));
+
+        if (transferred >= 0)
+            return transferred;
+        if (errno != EINTR)
+            return -errno;
+    }
+}
+
+// called from a catch block, the errno the reactor fails its operations with
+inline int currentError()
+{
+    try {
+        throw;
+    } catch (const std::system_error& error) {
+        return error.code().value() ? error.code().value() : EIO;
+    } catch (const std::bad_alloc&) {
+        return ENOMEM;
+    } catch (...) {
+        return EIO;
+    }
+}
+
+} // end anonymous namespace
+
+#ifdef RIDE_CONCURRENCY_HAS_IO_URING
+
+// the rings shared with the kernel, only the reactor thread touches them
+class FileIO::Ring
+{
+    int ring_fd;
+    void* rings;
+    std::size_t rings_size;
+    io_uring_sqe* sqes;
+    std::size_t sqes_size;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_cqe* cqes;
+    unsigned sq_entries;
+
+    // the tail of the submissions not yet published to the kernel
+    unsigned next_tail;
+
+    // a read of the eventfd is kept in the ring, so a submission wakes the reactor
+    int event_fd;
+    std::uint64_t event_value;
+    bool wakeup_armed;
+
+    inline void close()
+    {
+        if (this->sqes)
+            ::munmap(this->sqes, this->sqes_size);
+        if (this->rings)
+            ::munmap(this->rings, this->rings_size);
+        if (this->ring_fd >= 0)
+            ::close(this->ring_fd);
+        if (this->event_fd >= 0)
+            ::close(this->event_fd);
+    }
+
+    static inline std::system_error lastError(const char* what)
+    { return std::system_error(errno, std::system_category(), what); }
+
+    inline bool hasCompletions() const
+    { return *this->cq_head != __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE); }
+
+    // the kernel ran out of room or memory for submissions, so waits for one of the
+    // operations it already has instead of retrying right away
+    inline void backOff()
+    {
+        if (this->hasCompletions())
+            return;
+
+        unsigned unsubmitted = this->next_tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+
+        // with nothing in the kernel no completion would ever come
+        if (this->in_flight + (this->wakeup_armed ? 1 : 0) <= unsubmitted)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return;
+        }
+
+        while (::syscall(__NR_io_uring_enter, this->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+            if (errno != EINTR)
+                throw lastError("io_uring_enter");
+    }
+  public:
+    // user data of the eventfd read, operations are identified by their address
+    static constexpr std::uint64_t wakeup = 0;
+
+    unsigned entries;
+    // operations in the kernel, the eventfd read not counted
+    unsigned in_flight;
+
+    Ring(unsigned queue_depth, const std::vector<FileBuffer>& buffers)
+      : ring_fd(-1)
+      , rings(nullptr)
+      , sqes(nullptr)
+      , next_tail(0)
+      , event_fd(-1)
+      , event_value(0)
+      , wakeup_armed(false)
+      , in_flight(0)
+    {
+        try {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            this->ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+            if (this->ring_fd < 0)
+                throw lastError("io_uring_setup");
+
+            // one mapping for both rings, plain reads and writes and no dropped completions
+            unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+            if ((params.features & required) != required)
+                throw std::system_error(ENOSYS, std::system_category(), "io_uring features");
+
+            std::size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            std::size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            this->rings_size = sq_size > cq_size ? sq_size : cq_size;
+
+            void* rings = ::mmap(nullptr, this->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                this->ring_fd, IORING_OFF_SQ_RING);
+            if (rings == MAP_FAILED)
+                throw lastError("io_uring mmap");
+            this->rings = rings;
+
+            this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = ::mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                this->ring_fd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+                throw lastError("io_uring mmap");
+            this->sqes = static_cast<io_uring_sqe*>(sqes);
+
+            char* base = static_cast<char*>(this->rings);
+            this->sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+            this->sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+            this->sq_mask = reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+            this->sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+            this->cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+            this->cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+            this->cq_mask = reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+            this->cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+            this->sq_entries = params.sq_entries;
+            this->next_tail = *this->sq_tail;
+
+            // one slot is kept for the eventfd read
+            this->entries = params.sq_entries > 1 ? params.sq_entries - 1 : 1;
+
+            if (!buffers.empty())
+            {
+                std::vector<iovec> vectors;
+                for (const FileBuffer& buffer : buffers)
+                    vectors.push_back(iovec{buffer.data, buffer.size});
+
+                if (::syscall(__NR_io_uring_register, this->ring_fd, IORING_REGISTER_BUFFERS,
+                        vectors.data(), static_cast<unsigned>(vectors.size())) < 0)
+                    throw lastError("io_uring_register");
+            }
+
+            this->event_fd = ::eventfd(0, EFD_CLOEXEC);
+            if (this->event_fd < 0)
+                throw lastError("eventfd");
+        } catch (...) {
+            this->close();
+            throw;
+        }
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator = (const Ring&) = delete;
+
+    ~Ring()
+    { this->close(); }
+
+    // nullptr once the submission ring is full
+    inline io_uring_sqe* nextSqe()
+    {
+        unsigned head = __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+
+        if (this->next_tail - head >= this->sq_entries)
+            return nullptr;
+
+        unsigned index = this->next_tail & *this->sq_mask;
+        this->sq_array[index] = index;
+        ++this->next_tail;
+
+        io_uring_sqe* sqe = &this->sqes[index];
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        return sqe;
+    }
+
+    inline bool armWakeup()
+    {
+        io_uring_sqe* sqe = this->nextSqe();
+        if (!sqe)
+            return false;
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = this->event_fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&this->event_value);
+        sqe->len = sizeof(this->event_value);
+        sqe->off = static_cast<std::uint64_t>(-1);
+        sqe->user_data = wakeup;
+
+        this->wakeup_armed = true;
+        return true;
+    }
+
+    inline bool push(FileOp& op)
+    {
+        io_uring_sqe* sqe = this->nextSqe();
+        if (!sqe)
+            return false;
+
+        switch (op.kind)
+        {
+          case FileOpKind::Read: sqe->opcode = IORING_OP_READ; break;
+          case FileOpKind::Write: sqe->opcode = IORING_OP_WRITE; break;
+          case FileOpKind::ReadFixed: sqe->opcode = IORING_OP_READ_FIXED; break;
+          case FileOpKind::WriteFixed: sqe->opcode = IORING_OP_WRITE_FIXED; break;
+        }
+
+        sqe->fd = op.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(op.buffer);
+        sqe->len = static_cast<unsigned>(op.length < maxTransfer ? op.length : maxTransfer);
+        sqe->off = op.offset;
+        if (op.isFixed())
+            sqe->buf_index = static_cast<std::uint16_t>(op.buffer_index);
+        sqe->user_data = reinterpret_cast<std::uint64_t>(&op);
+
+        ++this->in_flight;
+        return true;
+    }
+
+    // publishes the new submissions and waits until something completed
+    inline void enter()
+    {
+        __atomic_store_n(this->sq_tail, this->next_tail, __ATOMIC_RELEASE);
+
+        while (true)
+        {
+            unsigned to_submit = this->next_tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+
+            if (::syscall(__NR_io_uring_enter, this->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) >= 0)
+                return;
+
+            // the completions are reaped next, which makes room again
+            if (errno == EAGAIN || errno == EBUSY)
+            {
+                this->backOff();
+                return;
+            }
+            if (errno != EINTR)
+                throw lastError("io_uring_enter");
+        }
+    }
+
+    // takes back the submissions the kernel hasn't consumed, it only consumes
+    // them while entering the ring, so this is safe once entering failed
+    template <class Func_>
+    inline void retract(Func_ func)
+    {
+        unsigned head = __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+
+        for (unsigned tail = head; tail != this->next_tail; ++tail)
+        {
+            std::uint64_t user_data = this->sqes[this->sq_array[tail & *this->sq_mask]].user_data;
+
+            if (user_data != wakeup)
+                --this->in_flight;
+            else
+                this->wakeup_armed = false;
+
+            func(user_data, -ECANCELED);
+        }
+
+        this->next_tail = head;
+        __atomic_store_n(this->sq_tail, head, __ATOMIC_RELEASE);
+    }
+
+    template <class Func_>
+    inline void reap(Func_ func)
+    {
+        unsigned head = *this->cq_head;
+        unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = this->cqes[head & *this->cq_mask];
+            std::uint64_t user_data = cqe.user_data;
+            std::int32_t result = cqe.res;
+
+            // handed back before the handler runs, the entry may be reused right away
+            __atomic_store_n(this->cq_head, head + 1, __ATOMIC_RELEASE);
+
+            if (user_data != wakeup)
+                --this->in_flight;
+            else
+                this->wakeup_armed = false;
+
+            func(user_data, result);
+        }
+    }
+
+    inline void wake()
+    {
+        std::uint64_t one = 1;
+        while (::write(this->event_fd, &one, sizeof(one)) < 0 && errno == EINTR) { }
+    }
+};
+
+constexpr std::uint64_t FileIO::Ring::wakeup;
+
+#else
+
+class FileIO::Ring
+{
+  public:
+    Ring(unsigned, const std::vector<FileBuffer>&)
+    { throw std::system_error(ENOSYS, std::system_category(), "io_uring"); }
+
+    inline void wake()
+    { }
+};
+
+#endif
+
+constexpr unsigned FileIO::maxThreads;
+
+FileIO::FileIO(std::shared_ptr<ThreadPool> pool, std::vector<FileBuffer> buffers, unsigned queue_depth, FileIOBackend backend)
+  : pool(pool)
+  , buffers(std::move(buffers))
+  , stopping(false)
+  , failure(0)
+{
+    if (backend != FileIOBackend::Thread)
+    {
+        try {
+            this->ring.reset(new Ring(queue_depth, this->buffers));
+        } catch (const std::system_error&) {
+            // a kernel without io_uring, or one it's disabled in
+            if (backend == FileIOBackend::Ring)
+                throw;
+        }
+    }
+
+    if (this->ring)
+        this->reactors.emplace_back(&FileIO::runRing, this);
+    else
+    {
+        unsigned threads = std::max(std::min(queue_depth, maxThreads), 1u);
+
+        for (unsigned i = 0; i < threads; ++i)
+            this->reactors.emplace_back(&FileIO::runThread, this);
+    }
+}
+
+FileIO::~FileIO()
+{
+    {
+        LockGuard lock(this->mutex);
+        this->stopping = true;
+    }
+
+    this->wake(true);
+
+    for (std::thread& reactor : this->reactors)
+        reactor.join();
+}
+
+FileIOBackend FileIO::backend() const
+{ return this->ring ? FileIOBackend::Ring : FileIOBackend::Thread; }
+
+void FileIO::prepare(FileOp& op) const
+{
+    if (!op.isFixed())
+        return;
+
+    if (op.buffer_index >= this->buffers.size())
+        throw std::out_of_range("no registered buffer with that index");
+
+    const FileBuffer& buffer = this->buffers[op.buffer_index];
+
+    if (op.buffer_offset > buffer.size || op.length > buffer.size - op.buffer_offset)
+        throw std::out_of_range("the operation doesn't fit its registered buffer");
+
+    op.buffer = static_cast<char*>(buffer.data) + op.buffer_offset;
+}
+
+void FileIO::enqueue(std::vector<PolymorphicOp>& ops)
+{
+    if (ops.empty())
+        return;
+
+    for (PolymorphicOp& op : ops)
+        this->prepare(*op);
+
+    int failure;
+
+    {
+        LockGuard lock(this->mutex);
+
+        failure = this->failure;
+        if (!failure)
+            for (PolymorphicOp& op : ops)
+                this->pending.push_back(std::move(op));
+    }
+
+    if (failure)
+    {
+        for (PolymorphicOp& op : ops)
+            op->abandon(failure);
+    }
+    else
+        this->wake(ops.size() > 1);
+
+    ops.clear();
+}
+
+void FileIO::enqueue(PolymorphicOp&& op)
+{
+    std::vector<PolymorphicOp> ops;
+    ops.push_back(std::move(op));
+    this->enqueue(ops);
+}
+
+void FileIO::fail(std::vector<PolymorphicOp>& ops, int error)
+{
+    {
+        LockGuard lock(this->mutex);
+
+        this->failure = error;
+
+        for (PolymorphicOp& op : this->pending)
+            ops.push_back(std::move(op));
+        this->pending.clear();
+
+        // the other reactor threads stop too
+        this->wakeup.notify_all();
+    }
+
+    for (PolymorphicOp& op : ops)
+        op->abandon(error);
+    ops.clear();
+}
+
+void FileIO::deliver(PolymorphicOp&& op)
+{
+    ThreadPool::PolymorphicJob job(op.release());
+
+    try {
+        this->pool->scheduleJob(ScheduleJobKey(), std::move(job));
+    } catch (...) {
+        // handed back, so the reactor can fail it
+        op.reset(static_cast<FileOp*>(job.release()));
+        throw;
+    }
+}
+
+void FileIO::drainRing(std::vector<PolymorphicOp>& ops)
+{
+#ifdef RIDE_CONCURRENCY_HAS_IO_URING
+    Ring& ring = *this->ring;
+
+    auto reclaim = [&ops](std::uint64_t user_data, std::int32_t) {
+        if (user_data == Ring::wakeup)
+            return;
+
+        PolymorphicOp op(reinterpret_cast<FileOp*>(user_data));
+
+        try {
+            ops.push_back(std::move(op));
+        } catch (...) {
+            // the kernel is done with it, so it can't wait for the others
+            op->abandon(ENOMEM);
+        }
+    };
+
+    while (ring.in_flight)
+    {
+        try {
+            ring.enter();
+        } catch (...) {
+            // completions still arrive without entering the ring, only slower
+            ring.retract(reclaim);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        ring.reap(reclaim);
+    }
+#else
+    (void)ops;
+#endif
+}
+
+bool FileIO::collect(std::vector<PolymorphicOp>& ops)
+{
+    LockGuard lock(this->mutex);
+
+    for (PolymorphicOp& op : this->pending)
+        ops.push_back(std::move(op));
+    this->pending.clear();
+
+    return this->stopping;
+}
+
+bool FileIO::take(PolymorphicOp& op)
+{
+    Lock lock(this->mutex);
+
+    // failing drained pending, what is left is for the thread that failed
+    this->wakeup.wait(lock, [this]() { return this->stopping || this->failure || !this->pending.empty(); });
+
+    if (this->failure || this->pending.empty())
+        return false;
+
+    op = std::move(this->pending.front());
+    this->pending.pop_front();
+    return true;
+}
+
+void FileIO::wake(bool everyone)
+{
+    if (this->ring)
+        this->ring->wake();
+    else
+    {
+        // taken so the reactor can't miss it between checking and waiting
+        LockGuard lock(this->mutex);
+
+        if (everyone)
+            this->wakeup.notify_all();
+        else
+            this->wakeup.notify_one();
+    }
+}
+
+void FileIO::runRing()
+{
+#ifdef RIDE_CONCURRENCY_HAS_IO_URING
+    Ring& ring = *this->ring;
+
+    // taken from pending but not in the kernel yet, the ones in the kernel are
+    // released to it and taken back from their completions
+    std::vector<PolymorphicOp> ops;
+    bool arm_wakeup = true;
+    bool stopping = false;
+
+    try {
+        while (true)
+        {
+            if (arm_wakeup && ring.armWakeup())
+                arm_wakeup = false;
+
+            std::size_t pushed = 0;
+            while (pushed < ops.size() && ring.in_flight < ring.entries && ring.push(*ops[pushed]))
+                ops[pushed++].release();
+            ops.erase(ops.begin(), ops.begin() + pushed);
+
+            if (stopping && ops.empty() && !ring.in_flight)
+                return;
+
+            ring.enter();
+
+            ring.reap([this, &ops, &arm_wakeup, &stopping](std::uint64_t user_data, std::int32_t result) {
+                if (user_data == Ring::wakeup)
+                {
+                    stopping = this->collect(ops);
+                    // nothing submits once it's stopping, so the read isn't needed anymore
+                    arm_wakeup = !stopping;
+                    return;
+                }
+
+                PolymorphicOp op(reinterpret_cast<FileOp*>(user_data));
+                op->result = result;
+
+                try {
+                    this->deliver(std::move(op));
+                } catch (...) {
+                    // failed along with the rest
+                    if (op)
+                        ops.push_back(std::move(op));
+                    throw;
+                }
+            });
+        }
+    } catch (...) {
+        int error = currentError();
+
+        // the kernel may still be reading into or writing from the buffers of the
+        // operations it has, so they are only failed once it handed all of them back
+        this->drainRing(ops);
+        this->fail(ops, error);
+    }
+#endif
+}
+
+void FileIO::runThread()
+{
+    PolymorphicOp op;
+
+    try {
+        // one at a time, so a slow transfer only holds up the threads' share of the rest
+        while (this->take(op))
+        {
+            op->result = transfer(*op);
+            this->deliver(std::move(op));
+        }
+    } catch (...) {
+        int error = currentError();
+
+        // empty once it was delivered
+        std::vector<PolymorphicOp> left;
+        if (op)
+            left.push_back(std::move(op));
+
+        this->fail(left, error);
+    }
+}
+
+} // end namespace detail
+
+} // end namespace ride
+
+#endif
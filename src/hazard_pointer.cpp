@@ -0,0 +1,190 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <ride/concurrency/detail/hazard_pointer.hpp>
+
+namespace ride { namespace detail {
+
+namespace {
+
+typedef std::pair<void*, void (*)(void*)> Retired;
+
+class HazardDomain
+{
+    std::atomic<HazardRecord*> records;
+    std::atomic_size_t num_records;
+    // left behind by threads that exited while their nodes were still protected
+    std::mutex orphans_mutex;
+    std::vector<Retired> orphans;
+  public:
+    HazardDomain()
+      : records(nullptr)
+      , num_records(0)
+    { }
+
+    // never destroyed, threads may still be exiting while statics are torn down
+    static inline HazardDomain& instance()
+    {
+        static HazardDomain* domain = new HazardDomain();
+        return *domain;
+    }
+
+    inline HazardRecord* acquire()
+    {
+        for (HazardRecord* record = this->records.load(std::memory_order_acquire); record; record = record->next)
+        {
+            bool inactive = false;
+            if (!record->active.load(std::memory_order_relaxed)
+                    && record->active.compare_exchange_strong(inactive, true, std::memory_order_acquire))
+                return record;
+        }
+
+        HazardRecord* record = new HazardRecord();
+        HazardRecord* head = this->records.load(std::memory_order_relaxed);
+
+        do
+            record->next = head;
+        while (!this->records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+
+        this->num_records.fetch_add(1, std::memory_order_relaxed);
+        return record;
+    }
+
+    inline void release(HazardRecord* record)
+    {
+        record->pointer.store(nullptr, std::memory_order_release);
+        record->active.store(false, std::memory_order_release);
+    }
+
+    // enough retired nodes that a scan frees most of them
+    inline std::size_t scanThreshold() const
+    { return 2 * this->num_records.load(std::memory_order_relaxed) + 64; }
+
+    // delete the retired pointers no record protects, keeping the rest
+    inline void scan(std::vector<Retired>& retired)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->orphans_mutex);
+
+            retired.insert(retired.end(), this->orphans.begin(), this->orphans.end());
+            this->orphans.clear();
+        }
+
+        // pairs with the store in HazardPointer::protect
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::vector<const void*> hazards;
+        for (HazardRecord* record = this->records.load(std::memory_order_acquire); record; record = record->next)
+            if (const void* pointer = record->pointer.load(std::memory_order_seq_cst))
+                hazards.push_back(pointer);
+
+        std::sort(hazards.begin(), hazards.end());
+
+        auto protect = std::partition(retired.begin(), retired.end(), [&hazards](const Retired& node)
+        { return std::binary_search(hazards.begin(), hazards.end(), node.first); });
+
+        std::vector<Retired> unprotected(protect, retired.end());
+        retired.erase(protect, retired.end());
+
+        for (Retired& node : unprotected)
+            node.second(node.first);
+    }
+
+    inline void orphan(std::vector<Retired>& retired)
+    {
+        std::lock_guard<std::mutex> lock(this->orphans_mutex);
+
+        this->orphans.insert(this->orphans.end(), retired.begin(), retired.end());
+        retired.clear();
+    }
+};
+
+// the per thread side of the domain, a cached record and the nodes retired by this thread
+class ThreadHazards
+{
+  public:
+    HazardRecord* record;
+    bool record_in_use;
+    std::vector<Retired> retired;
+
+    ThreadHazards()
+      : record(nullptr)
+      , record_in_use(false)
+    { }
+
+    ~ThreadHazards()
+    {
+        HazardDomain& domain = HazardDomain::instance();
+
+        if (this->record)
+            domain.release(this->record);
+
+        domain.scan(this->retired);
+        if (!this->retired.empty())
+            domain.orphan(this->retired);
+    }
+
+    static inline ThreadHazards& local()
+    {
+        static thread_local ThreadHazards hazards;
+        return hazards;
+    }
+};
+
+} // end anonymous namespace
+
+HazardPointer::HazardPointer()
+  : record(nullptr)
+  , cached(false)
+{
+    ThreadHazards& local = ThreadHazards::local();
+
+    if (!local.record_in_use)
+    {
+        if (!local.record)
+            local.record = HazardDomain::instance().acquire();
+
+        local.record_in_use = true;
+        this->record = local.record;
+        this->cached = true;
+    }
+    else
+        this->record = HazardDomain::instance().acquire();
+}
+
+HazardPointer::~HazardPointer()
+{
+    if (this->cached)
+    {
+        this->clear();
+        ThreadHazards::local().record_in_use = false;
+    }
+    else
+        HazardDomain::instance().release(this->record);
+}
+
+void HazardPointer::retire(void* pointer, void (*deleter)(void*))
+{
+    ThreadHazards& local = ThreadHazards::local();
+    HazardDomain& domain = HazardDomain::instance();
+
+    local.retired.emplace_back(pointer, deleter);
+
+    if (local.retired.size() >= domain.scanThreshold())
+        domain.scan(local.retired);
+}
+
+void HazardPointer::reclaim()
+{ HazardDomain::instance().scan(ThreadHazards::local().retired); }
+
+} // end namespace detail
+
+} // end namespace ride
@@ -0,0 +1,326 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <ride/concurrency/thread_pool.hpp>
+
+namespace ride { namespace detail {
+
+namespace {
+
+inline std::int64_t elapsedSince(std::chrono::steady_clock::time_point start)
+{ return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); }
+
+} // end anonymous namespace
+
+bool PipelineStage::admit(PipelineToken& token)
+{
+    LockGuard lock(this->mutex);
+
+    if (!this->running && (this->mode == StageMode::SerialOutOfOrder || token.sequence == this->next_sequence))
+    {
+        this->running = true;
+        return true;
+    }
+
+    token.queued_at = std::chrono::steady_clock::now();
+
+    if (this->mode == StageMode::SerialInOrder)
+    {
+        std::size_t sequence = token.sequence;
+        this->waiting.emplace(sequence, std::move(token));
+    }
+    else
+        this->arrived.push_back(std::move(token));
+
+    if (this->unsafeQueued() > this->max_queued.load(std::memory_order_relaxed))
+        this->max_queued.store(this->unsafeQueued(), std::memory_order_relaxed);
+
+    return false;
+}
+
+bool PipelineStage::release(PipelineToken& next)
+{
+    LockGuard lock(this->mutex);
+
+    if (this->mode == StageMode::SerialInOrder)
+    {
+        auto found = this->waiting.find(++this->next_sequence);
+
+        if (found == this->waiting.end())
+        {
+            this->running = false;
+            return false;
+        }
+
+        next = std::move(found->second);
+        this->waiting.erase(found);
+    }
+    else
+    {
+        if (this->arrived.empty())
+        {
+            this->running = false;
+            return false;
+        }
+
+        next = std::move(this->arrived.front());
+        this->arrived.pop_front();
+    }
+
+    this->waited_ns.fetch_add(elapsedSince(next.queued_at), std::memory_order_relaxed);
+    return true;
+}
+
+void PipelineStage::reset()
+{
+    LockGuard lock(this->mutex);
+
+    this->running = false;
+    this->next_sequence = 0;
+    this->waiting.clear();
+    this->arrived.clear();
+    this->items = 0;
+    this->max_queued = 0;
+    this->busy_ns = 0;
+    this->waited_ns = 0;
+}
+
+PipelineStats PipelineStage::stats()
+{
+    PipelineStats stats;
+
+    LockGuard lock(this->mutex);
+
+    stats.items = this->items.load(std::memory_order_relaxed);
+    stats.busy = std::chrono::nanoseconds(this->busy_ns.load(std::memory_order_relaxed));
+    stats.waited = std::chrono::nanoseconds(this->waited_ns.load(std::memory_order_relaxed));
+    stats.queued = this->unsafeQueued();
+    stats.max_queued = this->max_queued.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+// the state of one run, shared by its jobs so the last of them can still finish
+// after run() has returned
+class Pipeline::Run
+{
+    typedef std::mutex Mutex;
+  public:
+    typedef std::unique_lock<Mutex> Lock;
+
+    Pipeline& pipeline;
+    std::shared_ptr<ThreadPool> pool;
+    std::size_t max_tokens;
+    Mutex mutex;
+    // true while the source has a job in the pool, so it never runs twice at once
+    bool producing;
+    bool stopped;
+    std::size_t in_flight;
+    std::size_t next_sequence;
+    std::exception_ptr error;
+    std::promise<void> done;
+
+    Run(Pipeline& pipeline, std::shared_ptr<ThreadPool> pool, std::size_t max_tokens)
+      : pipeline(pipeline)
+      , pool(pool)
+      , max_tokens(max_tokens)
+      , producing(false)
+      , stopped(false)
+      , in_flight(0)
+      , next_sequence(0)
+    { }
+
+    // takes a token for the source if it may produce another item
+    inline bool unsafeTryProduce()
+    {
+        if (this->producing || this->stopped || this->in_flight >= this->max_tokens)
+            return false;
+
+        this->producing = true;
+        ++this->in_flight;
+        return true;
+    }
+
+    inline void fail(std::exception_ptr error)
+    {
+        Lock lock(this->mutex);
+
+        if (!this->error)
+            this->error = error;
+        this->stopped = true;
+    }
+};
+
+// produces an item when it starts at the source, carries a token onward otherwise
+class Pipeline::RunJob final
+  : public AbstractJob
+{
+    std::shared_ptr<Run> run;
+    PipelineToken token;
+    std::size_t stage;
+    bool admitted;
+  public:
+    // internal, dropping it would leave the run hanging
+    RunJob(std::shared_ptr<Run> run, PipelineToken&& token, std::size_t stage, bool admitted)
+      : AbstractJob(Kind::Internal)
+      , run(run)
+      , token(std::move(token))
+      , stage(stage)
+      , admitted(admitted)
+    { }
+
+    inline void operator()(const PoolWorkerKey&) override
+    {
+        if (this->stage == 0)
+            Pipeline::produce(this->run);
+        else
+            Pipeline::advance(this->run, std::move(this->token), this->stage, this->admitted);
+    }
+};
+
+void Pipeline::schedule(const std::shared_ptr<Run>& run, PipelineToken&& token, std::size_t stage, bool admitted)
+{
+    run->pool->scheduleJob(ScheduleJobKey(), ThreadPool::PolymorphicJob(new RunJob(run, std::move(token), stage, admitted)));
+}
+
+void Pipeline::execute(Run& run, PipelineStage& stage, PipelineToken& token)
+{
+    if (token.failed)
+        return;
+
+    FlowControl flow;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    try {
+        stage.process(flow, token.item);
+    } catch (...) {
+        token.failed = true;
+        token.item.reset();
+        run.fail(std::current_exception());
+    }
+
+    stage.busy_ns.fetch_add(elapsedSince(start), std::memory_order_relaxed);
+    stage.items.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Pipeline::produce(const std::shared_ptr<Run>& run)
+{
+    PipelineStage& source = *run->pipeline.stages.front();
+    PipelineToken token;
+    FlowControl flow;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    try {
+        source.process(flow, token.item);
+    } catch (...) {
+        run->fail(std::current_exception());
+    }
+
+    source.busy_ns.fetch_add(elapsedSince(start), std::memory_order_relaxed);
+
+    Run::Lock lock(run->mutex);
+
+    run->producing = false;
+
+    if (flow.isStopped() || run->stopped)
+    {
+        run->stopped = true;
+        bool finished = --run->in_flight == 0;
+        lock.unlock();
+
+        if (finished)
+            run->done.set_value();
+        return;
+    }
+
+    source.items.fetch_add(1, std::memory_order_relaxed);
+    token.sequence = run->next_sequence++;
+    bool more = run->unsafeTryProduce();
+    lock.unlock();
+
+    if (more)
+        schedule(run, PipelineToken(), 0, false);
+
+    advance(run, std::move(token), 1, false);
+}
+
+void Pipeline::advance(const std::shared_ptr<Run>& run, PipelineToken&& token, std::size_t stage, bool admitted)
+{
+    std::vector<std::unique_ptr<PipelineStage>>& stages = run->pipeline.stages;
+
+    for (; stage < stages.size(); ++stage, admitted = false)
+    {
+        PipelineStage& current = *stages[stage];
+
+        if (current.mode == StageMode::Parallel)
+        {
+            execute(*run, current, token);
+            continue;
+        }
+
+        // whoever finishes the token ahead of this one picks it up
+        if (!admitted && !current.admit(token))
+            return;
+
+        execute(*run, current, token);
+
+        PipelineToken next;
+        if (current.release(next))
+            schedule(run, std::move(next), stage, true);
+    }
+
+    finish(run);
+}
+
+void Pipeline::finish(const std::shared_ptr<Run>& run)
+{
+    Run::Lock lock(run->mutex);
+
+    --run->in_flight;
+    bool more = run->unsafeTryProduce();
+    bool finished = run->stopped && run->in_flight == 0;
+
+    lock.unlock();
+
+    if (more)
+        schedule(run, PipelineToken(), 0, false);
+    if (finished)
+        run->done.set_value();
+}
+
+void Pipeline::run(std::shared_ptr<ThreadPool> pool, std::size_t max_tokens)
+{
+    for (std::unique_ptr<PipelineStage>& stage : this->stages)
+        stage->reset();
+
+    std::shared_ptr<Run> run = std::make_shared<Run>(*this, pool, std::max<std::size_t>(max_tokens, 1));
+    std::future<void> done = run->done.get_future();
+
+    Run::Lock lock(run->mutex);
+    run->unsafeTryProduce();
+    lock.unlock();
+
+    schedule(run, PipelineToken(), 0, false);
+
+    pool->waitFor(done);
+
+    if (run->error)
+        std::rethrow_exception(run->error);
+}
+
+std::vector<PipelineStats> Pipeline::stats() const
+{
+    std::vector<PipelineStats> stats;
+
+    for (const std::unique_ptr<PipelineStage>& stage : this->stages)
+        stats.push_back(stage->stats());
+
+    return stats;
+}
+
+} // end namespace detail
+
+} // end namespace ride
@@ -5,9 +5,13 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <ride/concurrency/thread_pool.hpp>
+#include <ride/concurrency/detail/hazard_pointer.hpp>
 
 namespace ride { namespace detail {
 
+ThreadPool::~ThreadPool()
+{ delete this->local_queues.load(std::memory_order_relaxed); }
+
 std::pair<std::thread::id, ThreadPool::PolymorphicWorker> ThreadPool::createWorker(PolymorphicWorkerFactory factory)
 {
     PolymorphicWorker worker = factory->create(this->shared_from_this());
@@ -17,15 +21,32 @@ std::pair<std::thread::id, ThreadPool::PolymorphicWorker> ThreadPool::createWork
 
 void ThreadPool::unsafeAddWorkers(std::size_t to_create, PolymorphicWorkerFactory factory, LockPtr lock)
 {
-    this->num_pseudo_workers += to_create;
-
+    // counted one at a time, so a factory that throws leaves the count matching the workers
     for (std::size_t i = 0; i < to_create; ++i)
+    {
         workers.insert(createWorker(factory));
+        ++this->num_pseudo_workers;
+    }
+
+    if (to_create)
+        this->unsafePublishLocalQueues();
+
+    this->worker_factory = factory;
 
     if (lock)
         lock->unlock();
 }
 
+void ThreadPool::unsafePublishLocalQueues()
+{
+    std::unique_ptr<LocalQueues> queues(new LocalQueues());
+    for (auto& worker : this->workers)
+        queues->push_back(worker.second->localQueue(localKey));
+
+    // a thief may still be going through the old list
+    HazardPointer::retire(const_cast<LocalQueues*>(this->local_queues.exchange(queues.release(), std::memory_order_seq_cst)));
+}
+
 std::size_t ThreadPool::unsafeRemovePseudoWorkers(std::size_t to_remove, LockPtr lock)
 {
     to_remove = std::min(to_remove, this->numWorkers());
@@ -38,6 +59,155 @@ std::size_t ThreadPool::unsafeRemovePseudoWorkers(std::size_t to_remove, LockPtr
     return to_remove;
 }
 
+void ThreadPool::submit(PolymorphicJob&& job, bool priority)
+{
+    // counted before it can be taken, so a worker never finishes an uncounted job
+    this->addPendingJob(*job);
+    this->queue(std::move(job), priority);
+    this->finishQueuingJob();
+}
+
+void ThreadPool::queue(PolymorphicJob&& job, bool priority)
+{
+    if (!this->work.isBounded())
+    {
+        WorkerThread* worker = priority || this->work_paused ? nullptr : this->getCurrentWorker();
+
+        if (!worker)
+        {
+            this->work.forcePush(std::move(job), priority);
+            return;
+        }
+
+        // keep the job on the submitting worker, unless another worker has nothing to do
+        WorkerQueue& local = worker->localJobs(localKey);
+        local.push(std::move(job));
+
+        // a pause that started after the check above may have spilled the queue before
+        // the push, seq_cst on both sides means either it sees the job or this sees it
+        if (this->work_paused || this->num_idle_workers.load(std::memory_order_seq_cst) != 0)
+            local.drainTo(this->work);
+        return;
+    }
+
+    switch (this->rejection_policy)
+    {
+      case RejectionPolicy::Block:
+        // a worker waiting for room could be waiting on itself, so it runs the job instead
+        if (!this->isCurrentThreadInPool())
+        {
+            if (priority)
+                this->work.pushFront(std::move(job));
+            else
+                this->work.pushBack(std::move(job));
+            return;
+        }
+        // fall through
+      case RejectionPolicy::CallerRuns:
+        if (!this->work.offer(std::move(job), priority))
+        {
+            job->operator()(callerKey);
+            this->finishPendingJob(*job);
+        }
+        return;
+      case RejectionPolicy::Fail:
+        if (!this->work.offer(std::move(job), priority))
+        {
+            this->finishPendingJob(*job);
+            throw RejectedJobError();
+        }
+        return;
+      case RejectionPolicy::DropOldest:
+      {
+        PolymorphicJob dropped = nullptr;
+        this->work.pushDroppingOldest(std::move(job), priority, dropped);
+        if (dropped)
+            this->finishPendingJob(*dropped);
+        return;
+      }
+    }
+}
+
+WorkerThread* ThreadPool::getCurrentWorker() const
+{ return WorkerThread::currentOf(*this); }
+
+std::size_t ThreadPool::spillAllLocalJobs()
+{
+    HazardPointer hazard;
+
+    std::size_t moved = 0;
+    for (const std::shared_ptr<WorkerQueue>& queue : *hazard.protect(this->local_queues))
+        moved += queue->drainTo(this->work);
+
+    return moved;
+}
+
+void ThreadPool::pauseWork()
+{
+    this->work_paused = true;
+    this->work.setPaused(true);
+
+    this->spillAllLocalJobs();
+}
+
+std::size_t ThreadPool::remainingJobs() const
+{
+    std::size_t remaining = this->work.size();
+
+    HazardPointer hazard;
+
+    for (const std::shared_ptr<WorkerQueue>& queue : *hazard.protect(this->local_queues))
+        remaining += queue->size();
+
+    return remaining;
+}
+
+void ThreadPool::clearJobs()
+{
+    std::vector<PolymorphicJob> removed;
+    this->work.clearJobs(removed);
+
+    {
+        HazardPointer hazard;
+
+        for (const std::shared_ptr<WorkerQueue>& queue : *hazard.protect(this->local_queues))
+            queue->clear(removed);
+    }
+
+    // destroyed outside the locks, breaking their promises
+    for (PolymorphicJob& job : removed)
+        this->finishPendingJob(*job);
+}
+
+bool ThreadPool::stealJob(const PoolWorkerKey&, WorkerThread& thief, PolymorphicJob&& job)
+{
+    if (this->work_paused)
+        return false;
+
+    HazardPointer hazard;
+    WorkerQueue& own = thief.localJobs(localKey);
+
+    for (const std::shared_ptr<WorkerQueue>& queue : *hazard.protect(this->local_queues))
+        if (queue.get() != &own && queue->steal(std::move(job)))
+            return true;
+
+    return false;
+}
+
+void ThreadPool::spillJobs(const PoolWorkerKey&, WorkerQueue& local)
+{ local.drainTo(this->work); }
+
+bool ThreadPool::runPendingJob(WorkerThread* worker)
+{ return worker->runPendingJob(helperKey); }
+
+BlockingRegion::BlockingRegion(ThreadPool& pool)
+  : pool(pool)
+  , compensated(pool.beginBlocking(key))
+{ }
+
+BlockingRegion::~BlockingRegion()
+{ this->pool.endBlocking(key, this->compensated); }
+
 std::size_t ThreadPool::setupBarrier(std::shared_ptr<Barrier>& barrier) const
 {
     std::size_t num_workers = this->numWorkers();
@@ -48,7 +218,7 @@ std::size_t ThreadPool::setupBarrier(std::shared_ptr<Barrier>& barrier) const
     return num_workers;
 }
 
-void ThreadPool::safeJoin(bool remove_workers)
+void ThreadPool::safeJoin()
 {
     Lock lock(this->thread_management);
 
@@ -70,10 +240,7 @@ void ThreadPool::safeJoin(bool remove_workers)
 
     if (std::size_t num_workers = setupBarrier(this->join_barrier))
     { // don't setup a barrier if there are no workers
-        if (remove_workers)
-            unsafeRemoveWorkersLater(num_workers, nullptr);
-        else
-            synchronizeWorkers(num_workers, this->join_barrier);
+        unsafeRemoveWorkersLater(num_workers, nullptr);
 
         lock.unlock();
 
@@ -85,6 +252,75 @@ void ThreadPool::safeJoin(bool remove_workers)
         lock.unlock();
 }
 
+void ThreadPool::wait()
+{
+    // a worker would be waiting on its own job, and without workers nothing would finish
+    if (this->isCurrentThreadInPool() || this->numWorkers() == 0)
+        return;
+
+    LockGuard lock(this->wait_mutex);
+    unsigned epoch = this->submit_epoch.load(std::memory_order_relaxed);
+
+    // a submitter that read the epoch before the previous wait moved it on
+    // may only now be counting its job in the other one
+    this->waitForEpoch(epoch ^ 1);
+
+    this->submit_epoch.store(epoch ^ 1, std::memory_order_seq_cst);
+    this->waitForEpoch(epoch);
+}
+
+std::size_t ThreadPool::numTakenJobs() const
+{
+    // the queued ones first, a job is pending before it's queued and queued until it's taken
+    std::size_t queued = this->work.numJobs();
+
+    {
+        HazardPointer hazard;
+
+        for (const std::shared_ptr<WorkerQueue>& queue : *hazard.protect(this->local_queues))
+            queued += queue->size();
+    }
+
+    std::size_t pending = this->pending_jobs[0].load(std::memory_order_seq_cst)
+            + this->pending_jobs[1].load(std::memory_order_seq_cst);
+
+    return pending > queued ? pending - queued : 0;
+}
+
+void ThreadPool::waitForTakenJobs()
+{
+    while (this->numTakenJobs() != 0)
+    {
+        EventCount::Key key = this->quiescence.prepareWait();
+
+        if (this->numTakenJobs() == 0)
+        {
+            this->quiescence.cancelWait();
+            break;
+        }
+
+        this->quiescence.wait(key);
+    }
+}
+
+void ThreadPool::waitForEpoch(unsigned epoch)
+{
+    std::atomic_size_t& pending = this->pending_jobs[epoch];
+
+    while (pending.load(std::memory_order_seq_cst) != 0)
+    {
+        EventCount::Key key = this->quiescence.prepareWait();
+
+        if (pending.load(std::memory_order_seq_cst) == 0)
+        {
+            this->quiescence.cancelWait();
+            break;
+        }
+
+        this->quiescence.wait(key);
+    }
+}
+
 void ThreadPool::sync()
 {
     Lock lock(this->thread_management);
@@ -96,17 +332,64 @@ void ThreadPool::sync()
     lock.unlock();
 }
 
-void ThreadPool::handleOnShutdownWorker(const PoolWorkerKey&)
+ThreadPool::PolymorphicWorker ThreadPool::releaseWorker(const PoolWorkerKey&)
 {
-    this->onShutdownWorker();
-
     Lock lock(this->thread_management);
 
-    this->workers.erase(std::this_thread::get_id());
+    auto found = this->workers.find(std::this_thread::get_id());
+    PolymorphicWorker worker = std::move(found->second);
+    this->workers.erase(found);
+    this->unsafePublishLocalQueues();
 
     lock.unlock();
 
     --this->num_alive_workers;
+
+    return worker;
+}
+
+bool ThreadPool::beginBlocking(const BlockingRegionKey&)
+{
+    // the blocked worker's local jobs would otherwise wait for it
+    if (WorkerThread* worker = this->getCurrentWorker())
+        worker->localJobs(localKey).drainTo(this->work);
+
+    LockPtr lock(new Lock(this->thread_management));
+
+    // a join retires every worker anyway, so don't start new ones during it
+    if (!this->unsafeIsCurrentThreadInPool() || !this->worker_factory || this->join_barrier
+            || this->workers.size() >= this->max_threads)
+    {
+        lock->unlock();
+        return false;
+    }
+
+    ++this->num_compensating_workers;
+    this->unsafeAddWorkers(1, this->worker_factory, std::move(lock));
+
+    return true;
+}
+
+void ThreadPool::endBlocking(const BlockingRegionKey&, bool compensated)
+{
+    if (!compensated)
+        return;
+
+    Lock lock(this->thread_management);
+
+    --this->num_compensating_workers;
+
+    if (this->join_barrier)
+    {
+        lock.unlock();
+        return;
+    }
+
+    // whichever worker gets to the pill first retires, which restores the count
+    --this->num_pseudo_workers;
+    this->work.forcePush(this->createPoisonPill(nullptr), true);
+
+    lock.unlock();
 }
 
 } // end namespace detail
@@ -0,0 +1,123 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include <ride/concurrency/detail/rcu.hpp>
+
+namespace ride { namespace detail {
+
+RcuDomain::RcuDomain()
+  : epoch(1)
+  , pending(false)
+{ }
+
+RcuDomain::~RcuDomain()
+{
+    for (const Retired& entry : this->retired)
+        entry.deleter(entry.pointer);
+}
+
+RcuReader* RcuDomain::registerReader()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->free_readers.empty())
+    {
+        this->readers.emplace_back(*this);
+        return &this->readers.back();
+    }
+
+    RcuReader* reader = this->free_readers.back();
+    this->free_readers.pop_back();
+    return reader;
+}
+
+void RcuDomain::unregisterReader(RcuReader* reader)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    reader->depth = 0;
+    reader->seen.store(0, std::memory_order_release);
+    this->free_readers.push_back(reader);
+}
+
+std::size_t RcuDomain::unsafeReclaim()
+{
+    // a reader announced before an epoch may still hold what was retired in it
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+
+    for (const RcuReader& reader : this->readers)
+    {
+        std::uint64_t seen = reader.seen.load(std::memory_order_seq_cst);
+        if (seen != 0)
+            oldest = std::min(oldest, seen);
+    }
+
+    auto waiting = std::partition(this->retired.begin(), this->retired.end(),
+                                  [oldest](const Retired& entry) { return entry.epoch > oldest; });
+
+    for (auto it = waiting; it != this->retired.end(); ++it)
+        it->deleter(it->pointer);
+    this->retired.erase(waiting, this->retired.end());
+
+    this->pending.store(!this->retired.empty(), std::memory_order_relaxed);
+    return this->retired.size();
+}
+
+void RcuDomain::tryReclaim()
+{
+    std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+
+    // whoever holds the lock is retiring or reclaiming already
+    if (lock.owns_lock())
+        this->unsafeReclaim();
+}
+
+void RcuDomain::retire(void* pointer, void (*deleter)(void*))
+{
+    // readers announcing the new epoch come online after the pointer became unreachable
+    std::uint64_t retired_epoch = this->epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->retired.push_back(Retired { retired_epoch, pointer, deleter });
+    this->unsafeReclaim();
+}
+
+void RcuDomain::reclaim()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->unsafeReclaim();
+}
+
+void RcuDomain::synchronize()
+{
+    std::uint64_t target = this->epoch.load(std::memory_order_seq_cst);
+
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            this->unsafeReclaim();
+
+            bool done = std::none_of(this->retired.begin(), this->retired.end(),
+                                     [target](const Retired& entry) { return entry.epoch <= target; });
+            if (done)
+                return;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+} // end namespace detail
+
+} // end namespace ride
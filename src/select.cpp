@@ -0,0 +1,211 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <ride/concurrency/thread_pool.hpp>
+
+namespace ride { namespace detail {
+
+constexpr std::size_t Select::none;
+constexpr std::size_t Select::closed;
+
+// a select waiting on a pool instead of a thread, every notification schedules
+// a job to look at the cases unless one is already queued or looking
+class Select::Scheduled final
+  : public ChannelWaiter
+  , public std::enable_shared_from_this<Scheduled>
+{
+    enum State { Idle, Queued, Running, Renotified };
+
+    Select& select;
+    std::shared_ptr<ThreadPool> pool;
+    std::atomic_int state;
+    // only the channels know about it between jobs, so it keeps itself alive until it fired
+    std::shared_ptr<Scheduled> self;
+    std::promise<std::size_t> done;
+
+    inline void finish()
+    {
+        this->select.unsubscribe(*this);
+        this->self.reset();
+    }
+  public:
+    Scheduled(Select& select, std::shared_ptr<ThreadPool> pool)
+      : select(select)
+      , pool(pool)
+      // notifications while subscribing only mark it, start() schedules the first look
+      , state(Running)
+    { }
+
+    inline std::future<std::size_t> start()
+    {
+        std::future<std::size_t> future = this->done.get_future();
+
+        this->self = this->shared_from_this();
+        this->select.subscribe(*this);
+
+        this->state = Queued;
+        Select::submit(*this->pool, this->self);
+
+        return future;
+    }
+
+    inline void notify() override
+    {
+        int current = this->state.load();
+
+        while (true)
+        {
+            if (current == Idle)
+            {
+                if (this->state.compare_exchange_weak(current, Queued))
+                {
+                    Select::submit(*this->pool, this->shared_from_this());
+                    return;
+                }
+            }
+            else if (current == Running)
+            {
+                if (this->state.compare_exchange_weak(current, Renotified))
+                    return;
+            }
+            else
+                return;
+        }
+    }
+
+    inline void run()
+    {
+        this->state = Running;
+
+        while (true)
+        {
+            std::size_t fired;
+
+            try {
+                fired = this->select.tryOnce();
+            } catch (...) {
+                this->finish();
+                this->done.set_exception(std::current_exception());
+                return;
+            }
+
+            if (fired != Select::none)
+            {
+                this->finish();
+                this->done.set_value(fired);
+                return;
+            }
+
+            int expected = Running;
+            if (this->state.compare_exchange_strong(expected, Idle))
+                return;
+
+            // notified while looking, so look again
+            this->state = Running;
+        }
+    }
+};
+
+class Select::ScheduledJob final
+  : public AbstractJob
+{
+    std::shared_ptr<Scheduled> scheduled;
+  public:
+    // internal, dropping it would leave the select queued forever
+    ScheduledJob(std::shared_ptr<Scheduled> scheduled)
+      : AbstractJob(Kind::Internal)
+      , scheduled(scheduled)
+    { }
+
+    inline void operator()(const PoolWorkerKey&) override
+    { this->scheduled->run(); }
+};
+
+std::size_t Select::tryOnce()
+{
+    std::size_t dead = 0;
+
+    for (std::size_t i = 0; i < this->cases.size(); ++i)
+    {
+        std::size_t index = (this->first_case + i) % this->cases.size();
+
+        Result result = this->cases[index]->tryFire();
+
+        if (result == Result::Fired)
+        {
+            this->first_case = (index + 1) % this->cases.size();
+            return index;
+        }
+
+        if (result == Result::Dead)
+            ++dead;
+    }
+
+    return dead == this->cases.size() ? closed : none;
+}
+
+void Select::subscribe(ChannelWaiter& waiter)
+{
+    for (std::unique_ptr<Case>& select_case : this->cases)
+        select_case->subscribe(waiter);
+}
+
+void Select::unsubscribe(ChannelWaiter& waiter)
+{
+    for (std::unique_ptr<Case>& select_case : this->cases)
+        select_case->unsubscribe(waiter);
+}
+
+std::size_t Select::waitUntil(const std::chrono::steady_clock::time_point* timeout_time)
+{
+    std::size_t fired = this->tryOnce();
+    if (fired != none)
+        return fired;
+
+    BlockingWaiter waiter;
+    this->subscribe(waiter);
+
+    try {
+        while (true)
+        {
+            waiter.reset();
+
+            fired = this->tryOnce();
+            if (fired != none)
+                break;
+
+            if (!timeout_time)
+                waiter.wait();
+            else if (!waiter.waitUntil(*timeout_time))
+            {
+                fired = this->tryOnce();
+                break;
+            }
+        }
+    } catch (...) {
+        // a handler threw, the channels mustn't keep the waiter
+        this->unsubscribe(waiter);
+        throw;
+    }
+
+    this->unsubscribe(waiter);
+    return fired;
+}
+
+void Select::submit(ThreadPool& pool, std::shared_ptr<Scheduled> scheduled)
+{
+    pool.scheduleJob(ScheduleJobKey(), ThreadPool::PolymorphicJob(new ScheduledJob(scheduled)));
+}
+
+std::future<std::size_t> Select::schedule(std::shared_ptr<ThreadPool> pool)
+{
+    std::shared_ptr<Scheduled> scheduled = std::make_shared<Scheduled>(*this, pool);
+    return scheduled->start();
+}
+
+} // end namespace detail
+
+} // end namespace ride
@@ -0,0 +1,62 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <ride/concurrency/thread_pool.hpp>
+
+namespace ride { namespace detail {
+
+void Strand::schedule()
+{
+    this->pool->scheduleJob(scheduleKey, PolymorphicJob(new StrandJob(this->shared_from_this())));
+}
+
+void Strand::enqueue(PolymorphicJob&& job)
+{
+    Lock lock(this->mutex);
+
+    this->pending.push(std::move(job));
+
+    if (this->scheduled)
+    {
+        lock.unlock();
+        return;
+    }
+
+    this->scheduled = true;
+    lock.unlock();
+
+    this->schedule();
+}
+
+void Strand::runNext(const PoolWorkerKey& key)
+{
+    Lock lock(this->mutex);
+
+    PolymorphicJob job = std::move(this->pending.front());
+    this->pending.pop();
+
+    lock.unlock();
+
+    job->operator()(key);
+
+    lock.lock();
+
+    // give the worker back after every job so busy strands can't starve the others
+    if (this->pending.empty())
+    {
+        this->scheduled = false;
+        lock.unlock();
+    }
+    else
+    {
+        lock.unlock();
+        this->schedule();
+    }
+}
+
+} // end namespace detail
+
+} // end namespace ride
@@ -8,38 +8,54 @@
 
 namespace ride { namespace detail {
 
-void WorkerThread::run()
-{
-    this->handleOnStartup();
+thread_local WorkerThread* WorkerThread::current = nullptr;
 
-    std::unique_ptr<AbstractJob> job = nullptr;
-    bool timedout;
+ScratchArena* currentScratchArena()
+{ return WorkerThread::currentScratch(); }
 
-    while (!this->is_finished)
+bool WorkerThread::takeJob(std::unique_ptr<AbstractJob>&& job)
+{
+    if (!this->local->isEmpty() && !this->pool->isWorkPaused(key))
     {
+        // now and then the pool goes first, so a long chain of local jobs can't starve it
+        if (++this->local_ticks % poolCheckInterval == 0 && this->tryGetJobFromPool(std::move(job), std::try_to_lock))
+            return false;
+
+        if (this->local->pop(std::move(job)))
+            return false;
+    }
+
+    if (this->tryGetJobFromPool(std::move(job), std::try_to_lock))
+        return false;
+
+    // counted as idle before looking at the other workers, so a worker submitting
+    // locally afterwards sees this one and hands its jobs to the pool instead
+    this->pool->beginIdle(key);
+
+    bool timedout = false;
+    if (!this->pool->stealJob(key, *this, std::move(job)))
         timedout = this->getJob(std::move(job));
 
-        if (timedout)
-        {
-            this->handleOnTimeout();
-            continue;
-        }
+    this->pool->endIdle(key);
+
+    return timedout;
+}
 
-        if (!job)
-            continue;
-
-        if (job->isPoison()) {
-            this->handleOnShutdown();
-            job->operator()(key);
-            continue;
-        } else if (job->isSync()) {
-            this->handleOnSynchronize();
-            job->operator()(key);
-        } else {
-            this->handleBeforeExecute();
-            job->operator()(key);
-            this->handleAfterExecute();
+void WorkerThread::createLocals()
+{
+    // created outside the pool's lock, an init may well use the pool
+    for (WorkerLocalFactory& factory : this->pool->workerLocalFactories(key, this->locals.size()))
+    {
+        std::unique_ptr<WorkerLocalSlot> slot;
+
+        // a throwing init only fails its own slot, not the worker or the job that got here first
+        try {
+            slot = factory();
+        } catch (...) {
+            slot.reset(new WorkerLocalSlot(std::current_exception()));
         }
+
+        this->locals.push_back(std::move(slot));
     }
 }
 
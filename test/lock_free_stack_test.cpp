@@ -0,0 +1,70 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ride/concurrency/container/lock_free_stack.hpp>
+
+namespace {
+
+constexpr int numProducers = 4;
+constexpr int numConsumers = 4;
+constexpr int perProducer = 20000;
+
+// every value pushed is popped exactly once
+template <class Stack_>
+void stress(Stack_& stack)
+{
+    std::vector<std::atomic_int> seen(numProducers * perProducer);
+    for (std::atomic_int& count : seen)
+        count = 0;
+
+    std::atomic_int popped(0);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < numProducers; ++p)
+        threads.emplace_back([&stack, p]() {
+            for (int i = 0; i < perProducer; ++i)
+                stack.push(p * perProducer + i);
+        });
+
+    for (int c = 0; c < numConsumers; ++c)
+        threads.emplace_back([&stack, &seen, &popped]() {
+            int value;
+            while (popped.load() < numProducers * perProducer)
+                if (stack.tryPop(value))
+                {
+                    ++seen[value];
+                    ++popped;
+                }
+        });
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    EXPECT_TRUE(stack.isEmpty());
+    for (std::atomic_int& count : seen)
+        ASSERT_EQ(1, count.load());
+}
+
+} // end anonymous namespace
+
+TEST(LockFreeStack, ProducersAndConsumers)
+{
+    ride::ConcurrentLockFreeStack<int> stack;
+    stress(stack);
+}
+
+TEST(LockFreeStack, ProducersAndConsumersEliminating)
+{
+    // a single slot tried first, so most elements are handed over without the head
+    ride::ConcurrentLockFreeStack<int, 1, true> stack;
+    stress(stack);
+}
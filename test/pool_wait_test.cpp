@@ -0,0 +1,93 @@
+// Copyright (c) 2016 Nathan Currier
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ride/concurrency/thread_pool.hpp>
+
+namespace {
+
+std::shared_ptr<ride::ThreadPool> makePool(std::size_t num_workers)
+{
+    std::shared_ptr<ride::ThreadPool> pool = std::make_shared<ride::ThreadPool>();
+    pool->addWorkers(num_workers, std::make_shared<ride::WorkerThreadFactory<>>());
+    return pool;
+}
+
+} // end anonymous namespace
+
+TEST(PoolWait, WaitsForSubmittedJobs)
+{
+    std::shared_ptr<ride::ThreadPool> pool = makePool(2);
+    std::atomic_int finished(0);
+
+    for (int i = 0; i < 1000; ++i)
+        pool->emplaceJob(std::function<void()>([&finished]() { ++finished; }));
+
+    pool->wait();
+
+    EXPECT_EQ(1000, finished.load());
+
+    pool->join();
+}
+
+TEST(PoolWait, ReturnsWhileOthersKeepSubmitting)
+{
+    std::shared_ptr<ride::ThreadPool> pool = makePool(2);
+    std::atomic_bool submitting(true);
+
+    std::thread submitter([&pool, &submitting]() {
+        while (submitting)
+            pool->emplaceJob(std::function<void()>([]() { std::this_thread::yield(); }));
+    });
+
+    // let the submitter get ahead so the pool never runs dry
+    while (pool->remainingJobs() < 100)
+        std::this_thread::yield();
+
+    std::future<void> waited = std::async(std::launch::async, [&pool]() { pool->wait(); });
+    std::future_status status = waited.wait_for(std::chrono::seconds(30));
+
+    submitting = false;
+    submitter.join();
+
+    EXPECT_EQ(std::future_status::ready, status);
+
+    waited.wait();
+    pool->join();
+}
+
+TEST(PoolWait, WaitsForEarlierSlowJob)
+{
+    std::shared_ptr<ride::ThreadPool> pool = makePool(2);
+    std::atomic_bool slow_finished(false);
+
+    pool->emplaceJob(std::function<void()>([&slow_finished]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        slow_finished = true;
+    }));
+
+    std::future<bool> waited = std::async(std::launch::async, [&pool, &slow_finished]() {
+        pool->wait();
+        return slow_finished.load();
+    });
+
+    // quick jobs submitted during the wait finish first, but mustn't stand in for the slow one
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (int i = 0; i < 10; ++i)
+        pool->emplaceJob(std::function<void()>([]() { }));
+
+    EXPECT_TRUE(waited.get());
+
+    pool->join();
+}